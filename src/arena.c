@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+
+#define ARENA_ALIGN sizeof(void*)
+
+
+static ArenaBlock* arena_new_block(Arena* arena, size_t min_size) {
+    ArenaBlock** link = &arena->spare;
+    while (*link) {
+        ArenaBlock* block = *link;
+        if (block->size >= min_size) {
+            *link = block->next;
+            block->next = arena->head;
+            arena->head = block;
+            return block;
+        }
+        link = &block->next;
+    }
+
+    size_t size = min_size > ARENA_BLOCK_SIZE ? min_size : ARENA_BLOCK_SIZE;
+    ArenaBlock* block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + size);
+    if (!block) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    block->next = arena->head;
+    block->size = size;
+    block->used = 0;
+    arena->head = block;
+    arena->bytes_reserved += sizeof(ArenaBlock) + size;
+
+    return block;
+}
+
+
+void arena_init(Arena* arena) {
+    arena->head = NULL;
+    arena->spare = NULL;
+    arena->bytes_allocated = 0;
+    arena->bytes_reserved = 0;
+}
+
+
+void* arena_alloc(Arena* arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    ArenaBlock* block = arena->head;
+    if (!block || block->size - block->used < size) {
+        block = arena_new_block(arena, size);
+    }
+
+    void* ptr = block->data + block->used;
+    block->used += size;
+    arena->bytes_allocated += size;
+
+    return ptr;
+}
+
+
+char* arena_strndup(Arena* arena, const char* str, size_t len) {
+    char* copy = (char*)arena_alloc(arena, len + 1);
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+
+char* arena_strdup(Arena* arena, const char* str) {
+    return arena_strndup(arena, str, strlen(str));
+}
+
+
+static void free_blocks(ArenaBlock* block) {
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+}
+
+
+void arena_release(Arena* arena) {
+    free_blocks(arena->head);
+    free_blocks(arena->spare);
+    arena_init(arena);
+}
+
+
+void arena_reset(Arena* arena) {
+    ArenaBlock* block = arena->head;
+    while (block) {
+        ArenaBlock* next = block->next;
+        block->used = 0;
+        block->next = arena->spare;
+        arena->spare = block;
+        block = next;
+    }
+
+    arena->head = NULL;
+    arena->bytes_allocated = 0;
+}
@@ -0,0 +1,41 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t size;
+    size_t used;
+    char data[];
+} ArenaBlock;
+
+
+typedef struct {
+    ArenaBlock* head;
+    ArenaBlock* spare;        /* emptied blocks kept by arena_reset */
+    size_t bytes_allocated;   /* bytes handed out since the last release */
+    size_t bytes_reserved;    /* bytes obtained from malloc for blocks */
+} Arena;
+
+
+void arena_init(Arena* arena);
+
+void* arena_alloc(Arena* arena, size_t size);
+
+char* arena_strdup(Arena* arena, const char* str);
+
+char* arena_strndup(Arena* arena, const char* str, size_t len);
+
+/* Frees every block at once; the arena can be reused afterwards. */
+void arena_release(Arena* arena);
+
+/* Empties the arena but keeps its blocks for later allocations, so a
+   series of similar parses stops calling malloc after the first. */
+void arena_reset(Arena* arena);
+
+#endif
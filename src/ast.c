@@ -2,29 +2,191 @@
 #include <stdlib.h>
 #include <string.h>
 #include "ast.h"
+#include "arena.h"
+#include "intern.h"
+#include "walk.h"
+#include "outbuf.h"
+
+
+/* Every node and symbol string of the current parse lives here. The state
+   is per thread, so parsers on different threads never share an arena. */
+static _Thread_local Arena ast_arena;
+static _Thread_local InternTable ast_symbols;
+static _Thread_local size_t ast_node_count;
+static _Thread_local size_t ast_type_counts[NODE_TYPE_COUNT];
+static _Thread_local size_t ast_live_count;
+
+/* Nodes handed back by discard_ast, chained through `left`. */
+static _Thread_local ASTNode* ast_free_list;
+static _Thread_local AstWalker ast_discard_walker;
+
+/* Hash-consing: an open-addressing set of the consed nodes, keyed by
+   type, payload and children. */
+static _Thread_local int ast_hash_consing;
+static _Thread_local ASTNode** ast_cons_slots;
+static _Thread_local size_t ast_cons_capacity;
+static _Thread_local size_t ast_cons_count;
+static _Thread_local size_t ast_shared_count;
+
+
+const char* ast_intern(const char* str, size_t len) {
+    if (!ast_symbols.arena) {
+        intern_init(&ast_symbols, &ast_arena);
+    }
+    return intern_str(&ast_symbols, str, len);
+}
 
 
-ASTNode* create_node(NodeType type, const char* value) {
-    ASTNode* node = (ASTNode*)malloc(sizeof(ASTNode));
-    if (!node) {
-        fprintf(stderr, "Memory allocation failed\n");
-        exit(1);
+/* `sym` must already be interned; it is stored without copying. */
+static ASTNode* alloc_node(NodeType type, const char* sym) {
+    ASTNode* node = ast_free_list;
+    if (node) {
+        ast_free_list = node->left;
+    } else {
+        node = (ASTNode*)arena_alloc(&ast_arena, sizeof(ASTNode));
     }
+    ast_node_count++;
+    ast_type_counts[type]++;
+    ast_live_count++;
     
     node->type = type;
-    node->value = value ? strdup(value) : NULL;
+    node->count = 0;
+    node->value.sym = sym;
     node->left = NULL;
     node->right = NULL;
     node->next = NULL;
+    node->loc.offset = 0;
+    node->loc.length = 0;
     
     return node;
 }
 
 
+void ast_set_hash_consing(int enabled) {
+    ast_hash_consing = enabled;
+}
+
+
+void ast_cons_flush(void) {
+    if (ast_cons_count) {
+        memset(ast_cons_slots, 0, ast_cons_capacity * sizeof(ASTNode*));
+    }
+    ast_cons_count = 0;
+}
+
+
+/* The payload as one comparable word; symbols are interned, so equal
+   names have equal pointers. */
+static uintptr_t cons_payload(NodeType type, int number, const char* sym) {
+    if (type == NODE_INT || type == NODE_BINOP) return (uintptr_t)(unsigned)number;
+    return (uintptr_t)sym;
+}
+
+
+static size_t cons_hash(NodeType type, uintptr_t payload, const ASTNode* left, const ASTNode* right) {
+    uint64_t h = (uint64_t)type * 0x9E3779B97F4A7C15ull;
+    h = (h ^ payload) * 0xFF51AFD7ED558CCDull;
+    h = (h ^ (uintptr_t)left) * 0xC4CEB9FE1A85EC53ull;
+    h = (h ^ (uintptr_t)right) * 0x9E3779B97F4A7C15ull;
+    return (size_t)(h ^ (h >> 32));
+}
+
+
+static int cons_equal(const ASTNode* node, NodeType type, uintptr_t payload,
+                      const ASTNode* left, const ASTNode* right) {
+    int number = node->type == NODE_INT ? node->value.ival : (int)node->value.op;
+    return node->type == type && node->left == left && node->right == right &&
+           cons_payload(node->type, number, node->value.sym) == payload;
+}
+
+
+static void cons_grow(void) {
+    size_t capacity = ast_cons_capacity ? ast_cons_capacity * 2 : 1024;
+    ASTNode** slots = (ASTNode**)calloc(capacity, sizeof(ASTNode*));
+    if (!slots) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < ast_cons_capacity; i++) {
+        ASTNode* node = ast_cons_slots[i];
+        if (!node) continue;
+
+        int number = node->type == NODE_INT ? node->value.ival : (int)node->value.op;
+        size_t j = cons_hash(node->type, cons_payload(node->type, number, node->value.sym),
+                             node->left, node->right) & (capacity - 1);
+        while (slots[j]) {
+            j = (j + 1) & (capacity - 1);
+        }
+        slots[j] = node;
+    }
+
+    free(ast_cons_slots);
+    ast_cons_slots = slots;
+    ast_cons_capacity = capacity;
+}
+
+
+/* Returns the consed node with these fields, counting one more use, or
+   NULL with *slot set to where cons_add should put the new node. */
+static ASTNode* cons_find(NodeType type, int number, const char* sym,
+                          ASTNode* left, ASTNode* right, size_t* slot) {
+    if (2 * (ast_cons_count + 1) > ast_cons_capacity) {
+        cons_grow();
+    }
+
+    uintptr_t payload = cons_payload(type, number, sym);
+    size_t mask = ast_cons_capacity - 1;
+    size_t i = cons_hash(type, payload, left, right) & mask;
+
+    while (ast_cons_slots[i]) {
+        ASTNode* node = ast_cons_slots[i];
+        if (cons_equal(node, type, payload, left, right)) {
+            node->count++;
+            ast_shared_count++;
+            return node;
+        }
+        i = (i + 1) & mask;
+    }
+    *slot = i;
+    return NULL;
+}
+
+
+static ASTNode* cons_add(size_t slot, ASTNode* node) {
+    node->count = 1;
+    ast_cons_slots[slot] = node;
+    ast_cons_count++;
+    return node;
+}
+
+
+ASTNode* ast_unshare(ASTNode* node) {
+    if (!node || !AST_IS_CONSED(node)) return node;
+
+    ASTNode* copy = alloc_node(node->type, node->value.sym);
+    copy->value = node->value;
+    copy->left = node->left;
+    copy->right = node->right;
+    copy->loc = node->loc;
+    if (copy->left) copy->left->count++;
+    if (copy->right) copy->right->count++;
+    node->count--;
+    return copy;
+}
+
+
+ASTNode* create_node(NodeType type, const char* value) {
+    return alloc_node(type, value ? ast_intern(value, strlen(value)) : NULL);
+}
+
+
 void add_child(ASTNode* parent, ASTNode* child) {
     if (!parent || !child) return;
     
-    if (!parent->left) {
+    if (AST_HAS_ITEMS(parent)) {
+        list_append(parent, child);
+    } else if (!parent->left) {
         parent->left = child;
     } else if (!parent->right) {
         parent->right = child;
@@ -35,83 +197,116 @@ void add_child(ASTNode* parent, ASTNode* child) {
 }
 
 
-void add_sibling(ASTNode* node, ASTNode* sibling) {
-    if (!node || !sibling) return;
+ASTNode* add_sibling(ASTNode* node, ASTNode* sibling) {
+    if (!node || !sibling) return node;
     
     ASTNode* current = node;
     while (current->next) {
         current = current->next;
     }
     current->next = sibling;
+    
+    while (current->next) {
+        current = current->next;
+    }
+    return current;
 }
 
 
-static char* int_to_str(int value) {
-    char buffer[32];
-    snprintf(buffer, sizeof(buffer), "%d", value);
-    return strdup(buffer);
+const char* op_to_str(OpKind op) {
+    switch (op) {
+        case OP_ADD: return "+";
+        case OP_SUB: return "-";
+        case OP_MUL: return "*";
+        case OP_DIV: return "/";
+        case OP_LT: return "<";
+        case OP_INC: return "++";
+        case OP_DEC: return "--";
+        default: return "?";
+    }
 }
 
 
-static char* char_to_str(char c) {
-    char buffer[2] = {c, '\0'};
-    return strdup(buffer);
+ASTNode* make_int_node(int value) {
+    size_t slot = 0;
+    if (ast_hash_consing) {
+        ASTNode* shared = cons_find(NODE_INT, value, NULL, NULL, NULL, &slot);
+        if (shared) return shared;
+    }
+
+    ASTNode* node = alloc_node(NODE_INT, NULL);
+    node->value.ival = value;
+    return ast_hash_consing ? cons_add(slot, node) : node;
 }
 
 
-ASTNode* make_int_node(int value) {
-    char* val_str = int_to_str(value);
-    ASTNode* node = create_node(NODE_INT, val_str);
-    free(val_str);
-    return node;
+/* Strings and variables are consed by their interned name. */
+static ASTNode* make_named_leaf(NodeType type, const char* sym) {
+    size_t slot = 0;
+    if (ast_hash_consing) {
+        ASTNode* shared = cons_find(type, 0, sym, NULL, NULL, &slot);
+        if (shared) return shared;
+    }
+
+    ASTNode* node = alloc_node(type, sym);
+    return ast_hash_consing ? cons_add(slot, node) : node;
 }
 
 
-ASTNode* make_string_node(char* value) {
-    return create_node(NODE_STRING, value);
+ASTNode* make_string_node(const char* value) {
+    return make_named_leaf(NODE_STRING, value);
 }
 
 
-ASTNode* make_var_node(char* name) {
-    return create_node(NODE_VAR, name);
+ASTNode* make_var_node(const char* name) {
+    return make_named_leaf(NODE_VAR, name);
 }
 
 
-ASTNode* make_binop_node(char op, ASTNode* left, ASTNode* right) {
-    char* op_str = char_to_str(op);
-    ASTNode* node = create_node(NODE_BINOP, op_str);
-    free(op_str);
+ASTNode* make_binop_node(OpKind op, ASTNode* left, ASTNode* right) {
+    /* An operand that is not consed is never shared, and neither is any
+       expression built on it. */
+    int consed = ast_hash_consing && AST_IS_CONSED(left) && AST_IS_CONSED(right);
+    size_t slot = 0;
+    if (consed) {
+        ASTNode* shared = cons_find(NODE_BINOP, (int)op, NULL, left, right, &slot);
+        if (shared) return shared;
+    }
+
+    ASTNode* node = alloc_node(NODE_BINOP, NULL);
+    node->value.op = op;
     
     node->left = left;
     node->right = right;
     
-    return node;
+    return consed ? cons_add(slot, node) : node;
 }
 
 
-ASTNode* make_unary_node(char* op, ASTNode* expr) {
-    ASTNode* node = create_node(NODE_UNARY, op);
+ASTNode* make_unary_node(OpKind op, ASTNode* expr) {
+    ASTNode* node = alloc_node(NODE_UNARY, NULL);
+    node->value.op = op;
     node->left = expr;
     return node;
 }
 
 
-ASTNode* make_decl_node(char* name, ASTNode* init_expr) {
-    ASTNode* node = create_node(NODE_DECL, name);
+ASTNode* make_decl_node(const char* name, ASTNode* init_expr) {
+    ASTNode* node = alloc_node(NODE_DECL, name);
     node->left = init_expr;  
     return node;
 }
 
 
-ASTNode* make_func_call_node(char* name, ASTNode* args) {
-    ASTNode* node = create_node(NODE_FUNC_CALL, name);
+ASTNode* make_func_call_node(const char* name, ASTNode* args) {
+    ASTNode* node = alloc_node(NODE_FUNC_CALL, name);
     node->left = args;  
     return node;
 }
 
 
-ASTNode* make_function_node(char* name, ASTNode* body) {
-    ASTNode* node = create_node(NODE_FUNC_DEF, name);
+ASTNode* make_function_node(const char* name, ASTNode* body) {
+    ASTNode* node = alloc_node(NODE_FUNC_DEF, name);
     node->left = body; 
     return node;
 }
@@ -131,13 +326,13 @@ ASTNode* make_for_node(ASTNode* init, ASTNode* condition, ASTNode* update, ASTNo
    
     node->left = init;
     
+    /* The chain goes through `next`, which a shared node cannot carry. */
+    condition = ast_unshare(condition);
+    update = ast_unshare(update);
     node->right = condition;
     
     if (condition) {
-        add_sibling(condition, update);
-        if (update) {
-            add_sibling(update, body);
-        }
+        add_sibling(add_sibling(condition, update), body);
     }
     
     return node;
@@ -150,23 +345,109 @@ ASTNode* make_return_node(ASTNode* expr) {
 }
 
 
-ASTNode* make_expr_list_node(ASTNode* expr, ASTNode* next) {
-    ASTNode* node = create_node(NODE_EXPR_LIST, NULL);
-    node->left = expr;  
-    node->next = next; 
-    return node;
+ASTNode* make_expr_list_node(ASTNode* first) {
+    ASTNode* node = alloc_node(NODE_EXPR_LIST, NULL);
+    node->value.items = NULL;
+    return list_append(node, first);
 }
 
 
-ASTNode* make_seq_node(ASTNode* first, ASTNode* second) {
-    ASTNode* node = create_node(NODE_SEQ, NULL);
-    node->left = first;   
-    node->right = second; 
-    return node;
+#define LIST_MIN_CAPACITY 4
+
+
+/* The capacity is implied by the count: the array is reallocated each
+   time the count reaches a power of two, so no extra field is needed. */
+static int list_full(unsigned count) {
+    return count == 0 || (count >= LIST_MIN_CAPACITY && (count & (count - 1)) == 0);
+}
+
+
+static ASTNode** list_alloc_items(unsigned capacity) {
+    return (ASTNode**)arena_alloc(&ast_arena, capacity * sizeof(ASTNode*));
 }
 
 
-ASTNode* make_type_node(char* type_name) {
+ASTNode* make_block_node(ASTNode* first) {
+    ASTNode* node = alloc_node(NODE_SEQ, NULL);
+    node->value.items = NULL;
+    return list_append(node, first);
+}
+
+
+ASTNode* list_append(ASTNode* list, ASTNode* item) {
+    if (!item) return list;
+    
+    if (list_full(list->count)) {
+        unsigned capacity = list->count ? list->count * 2 : LIST_MIN_CAPACITY;
+        ASTNode** items = list_alloc_items(capacity);
+        if (list->count) {
+            memcpy(items, list->value.items, list->count * sizeof(ASTNode*));
+        }
+        list->value.items = items;
+    }
+    
+    list->value.items[list->count++] = item;
+    return list;
+}
+
+
+size_t block_compact(ASTNode* block) {
+    unsigned count = 0;
+    int nested = 0;
+    
+    for (unsigned i = 0; i < block->count; i++) {
+        ASTNode* item = block->value.items[i];
+        if (!item) continue;
+        
+        if (item->type == NODE_SEQ) {
+            count += item->count;
+            nested = 1;
+        } else {
+            count++;
+        }
+    }
+    
+    if (!nested) {
+        unsigned j = 0;
+        for (unsigned i = 0; i < block->count; i++) {
+            if (block->value.items[i]) {
+                block->value.items[j++] = block->value.items[i];
+            }
+        }
+        block->count = j;
+        return 0;
+    }
+    
+    unsigned capacity = LIST_MIN_CAPACITY;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    
+    ASTNode** items = list_alloc_items(capacity);
+    size_t discarded = 0;
+    unsigned j = 0;
+    
+    for (unsigned i = 0; i < block->count; i++) {
+        ASTNode* item = block->value.items[i];
+        if (!item) continue;
+        
+        if (item->type == NODE_SEQ) {
+            memcpy(items + j, item->value.items, item->count * sizeof(ASTNode*));
+            j += item->count;
+            item->count = 0;
+            discarded += discard_ast(item);
+        } else {
+            items[j++] = item;
+        }
+    }
+    
+    block->value.items = items;
+    block->count = j;
+    return discarded;
+}
+
+
+ASTNode* make_type_node(const char* type_name) {
     return create_node(NODE_TYPE, type_name);
 }
 
@@ -192,54 +473,186 @@ const char* get_node_type_str(NodeType type) {
 }
 
 
-void print_ast(ASTNode* node, FILE* output, int indent) {
-    if (!node) return;
-    
-
-    for (int i = 0; i < indent; i++) {
-        fprintf(output, "  ");
+typedef struct {
+    const char* text;
+    size_t len;
+} Label;
+
+#define LABEL(str) { str, sizeof(str) - 1 }
+
+
+/* Indexed by NodeType; lengths are known up front so printing a label is
+   a single memcpy. */
+static const Label node_labels[] = {
+    LABEL("INT"),
+    LABEL("STRING"),
+    LABEL("VAR"),
+    LABEL("DECLARATION"),
+    LABEL("BINARY_EXPR"),
+    LABEL("UNARY_EXPR"),
+    LABEL("FUNCTION_CALL"),
+    LABEL("FUNCTION_DEF"),
+    LABEL("IF_STMT"),
+    LABEL("FOR_STMT"),
+    LABEL("RETURN_STMT"),
+    LABEL("EXPR_LIST"),
+    LABEL("SEQUENCE"),
+    LABEL("TYPE")
+};
+
+
+void write_node_label(OutBuf* out, NodeType type, int number, const char* sym, int quoted) {
+    if ((size_t)type < sizeof(node_labels) / sizeof(node_labels[0])) {
+        outbuf_write(out, node_labels[type].text, node_labels[type].len);
+    } else {
+        outbuf_write(out, "UNKNOWN", 7);
     }
-    
 
-    fprintf(output, "%s", get_node_type_str(node->type));
-    if (node->value) {
-        fprintf(output, " (%s)", node->value);
+    switch (type) {
+        case NODE_INT:
+            outbuf_write(out, " (", 2);
+            outbuf_int(out, number);
+            outbuf_putc(out, ')');
+            break;
+        case NODE_BINOP:
+        case NODE_UNARY:
+            outbuf_write(out, " (", 2);
+            outbuf_puts(out, op_to_str((OpKind)number));
+            outbuf_putc(out, ')');
+            break;
+        case NODE_SEQ:
+        case NODE_EXPR_LIST:
+            break;
+        default:
+            if (sym) {
+                outbuf_write(out, " (", 2);
+                if (quoted) {
+                    outbuf_escaped(out, sym);
+                } else {
+                    outbuf_puts(out, sym);
+                }
+                outbuf_putc(out, ')');
+            }
+            break;
     }
-    fprintf(output, "\n");
+}
 
-    if (node->left) {
-        print_ast(node->left, output, indent + 1);
-    }
-    
-    if (node->right) {
-        print_ast(node->right, output, indent + 1);
-    }
-    
- 
-    if (node->next) {
-        print_ast(node->next, output, indent);
-    }
+
+void write_node_line(OutBuf* out, size_t depth, NodeType type, int number, const char* sym) {
+    outbuf_indent(out, depth);
+    write_node_label(out, type, number, sym, 0);
+    outbuf_putc(out, '\n');
 }
 
 
-void free_ast(ASTNode* node) {
+typedef struct {
+    OutBuf* out;
+    int indent;
+} PrintState;
+
+
+static WalkAction print_node(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    PrintState* ps = (PrintState*)ctx;
+    ASTNode* node = frame->node;
+    int number = node->type == NODE_INT ? node->value.ival : (int)node->value.op;
+    (void)walker;
+
+    write_node_line(ps->out, (size_t)(ps->indent + frame->depth), node->type, number,
+                    AST_HAS_ITEMS(node) ? NULL : node->value.sym);
+    return WALK_CONTINUE;
+}
+
+
+void write_ast(ASTNode* node, OutBuf* out, int indent) {
     if (!node) return;
     
-    if (node->value) {
-        free(node->value);
-    }
-    
-    if (node->left) {
-        free_ast(node->left);
-    }
+    PrintState ps = { out, indent };
+    AstWalker walker;
+    walker_init(&walker);
+    ast_walk(&walker, &node, print_node, NULL, &ps);
+    walker_free(&walker);
+}
+
+
+void print_ast(ASTNode* node, FILE* output, int indent) {
+    OutBuf out;
+    outbuf_init(&out, output);
+    write_ast(node, &out, indent);
+    outbuf_close(&out);
+}
+
+
+void free_ast(ASTNode* node) {
+    (void)node;
+
+    intern_reset(&ast_symbols);
+    arena_release(&ast_arena);
+    ast_free_list = NULL;
+    walker_free(&ast_discard_walker);
+    ast_node_count = 0;
+    memset(ast_type_counts, 0, sizeof(ast_type_counts));
+    ast_live_count = 0;
+    free(ast_cons_slots);
+    ast_cons_slots = NULL;
+    ast_cons_capacity = 0;
+    ast_cons_count = 0;
+    ast_shared_count = 0;
+}
+
+
+void reset_ast(void) {
+    intern_clear(&ast_symbols);
+    arena_reset(&ast_arena);
+    ast_free_list = NULL;
+    ast_node_count = 0;
+    memset(ast_type_counts, 0, sizeof(ast_type_counts));
+    ast_live_count = 0;
+    ast_cons_flush();
+    ast_shared_count = 0;
+}
+
+
+/* Consed nodes stay in the cons table, so they are only released with
+   the arena; a discard just drops one use. */
+static WalkAction discard_shared(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    (void)walker;
+    (void)ctx;
+
+    if (!AST_IS_CONSED(frame->node)) return WALK_CONTINUE;
+    frame->node->count--;
+    frame->data = 1;
+    return WALK_SKIP;
+}
+
+
+static WalkAction discard_node(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    ASTNode* node = frame->node;
+    (void)walker;
     
-    if (node->right) {
-        free_ast(node->right);
-    }
+    if (frame->data) return WALK_CONTINUE;
+    node->left = ast_free_list;
+    ast_free_list = node;
+    ast_live_count--;
+    (*(size_t*)ctx)++;
     
-    if (node->next) {
-        free_ast(node->next);
-    }
+    return WALK_CONTINUE;
+}
+
+
+size_t discard_ast(ASTNode* node) {
+    size_t reclaimed = 0;
+    if (!node) return 0;
     
-    free(node);
-}
\ No newline at end of file
+    ast_walk_node(&ast_discard_walker, &node, discard_shared, discard_node, &reclaimed);
+    return reclaimed;
+}
+
+
+void ast_alloc_stats(AstAllocStats* stats) {
+    stats->nodes = ast_node_count;
+    stats->live = ast_live_count;
+    stats->bytes = ast_arena.bytes_allocated;
+    stats->reserved = ast_arena.bytes_reserved;
+    stats->shared = ast_shared_count;
+    memcpy(stats->created, ast_type_counts, sizeof(ast_type_counts));
+}
@@ -4,6 +4,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include "outbuf.h"
 
 
 typedef enum {
@@ -23,32 +25,95 @@ typedef enum {
     NODE_TYPE
 } NodeType;
 
+#define NODE_TYPE_COUNT (NODE_TYPE + 1)
 
+
+typedef enum {
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_LT,
+    OP_INC,
+    OP_DEC
+} OpKind;
+
+
+/* Where a node's text sits in its source file: a byte offset and length.
+   Line and column are derived on demand (see LineIndex in source.h). */
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+} SrcSpan;
+
+
+/* The payload is selected by `type`: NODE_INT uses ival, NODE_BINOP and
+   NODE_UNARY use op, NODE_SEQ and NODE_EXPR_LIST use items (an array of
+   `count` children), every other kind uses sym (an interned string or NULL).
+   On other kinds, a nonzero `count` marks a hash-consed node and counts
+   its uses. */
 typedef struct ASTNode {
     NodeType type;
-    char* value;           
+    unsigned count;
+    union {
+        int ival;
+        OpKind op;
+        const char* sym;
+        struct ASTNode** items;
+    } value;
     struct ASTNode* left;  
     struct ASTNode* right; 
     struct ASTNode* next;  
+    SrcSpan loc;           /* {0, 0} for nodes that were not parsed */
 } ASTNode;
 
+#define AST_HAS_ITEMS(node) ((node)->type == NODE_SEQ || (node)->type == NODE_EXPR_LIST)
+
+#define AST_IS_CONSED(node) (!AST_HAS_ITEMS(node) && (node)->count > 0)
+
+
+/* Turns hash-consing on or off for the calling thread. While it is on,
+   make_int_node, make_string_node and make_var_node return one shared
+   node per distinct value, and make_binop_node does the same when both
+   operands are consed. The tree then becomes a DAG. Consed nodes are
+   immutable: passes rewrite them by storing a new node into the parent's
+   link. They keep the span of their first occurrence. Folding and
+   printing still see one copy per use. */
+void ast_set_hash_consing(int enabled);
+
+/* Makes later constructor calls on this thread build new shared nodes
+   instead of reusing the ones made so far, which stay immutable. The
+   parser calls it after each function, so no node is shared between two
+   functions and they can be optimized on different threads. */
+void ast_cons_flush(void);
+
+/* Returns `node` itself, or for a consed node a private copy that may be
+   modified; its children stay shared. Takes over the caller's use. */
+ASTNode* ast_unshare(ASTNode* node);
+
+
+/* Returns the per-parse unique copy of str[0..len). Names handed to the
+   make_*_node constructors (except make_type_node) must come from here;
+   they are stored without copying. */
+const char* ast_intern(const char* str, size_t len);
+
 
 ASTNode* make_int_node(int value);
 
 
-ASTNode* make_string_node(char* value);
+ASTNode* make_string_node(const char* value);
 
-ASTNode* make_var_node(char* name);
+ASTNode* make_var_node(const char* name);
 
-ASTNode* make_binop_node(char op, ASTNode* left, ASTNode* right);
+ASTNode* make_binop_node(OpKind op, ASTNode* left, ASTNode* right);
 
-ASTNode* make_unary_node(char* op, ASTNode* expr);
+ASTNode* make_unary_node(OpKind op, ASTNode* expr);
 
-ASTNode* make_decl_node(char* name, ASTNode* init_expr);
+ASTNode* make_decl_node(const char* name, ASTNode* init_expr);
 
-ASTNode* make_func_call_node(char* name, ASTNode* args);
+ASTNode* make_func_call_node(const char* name, ASTNode* args);
 
-ASTNode* make_function_node(char* name, ASTNode* body);
+ASTNode* make_function_node(const char* name, ASTNode* body);
 
 
 ASTNode* make_if_node(ASTNode* condition, ASTNode* then_body);
@@ -59,20 +124,70 @@ ASTNode* make_for_node(ASTNode* init, ASTNode* condition, ASTNode* update, ASTNo
 ASTNode* make_return_node(ASTNode* expr);
 
 
-ASTNode* make_expr_list_node(ASTNode* expr, ASTNode* next);
+/* Arguments are kept in source order in a growable array, like blocks. */
+ASTNode* make_expr_list_node(ASTNode* first);
 
 
-ASTNode* make_seq_node(ASTNode* first, ASTNode* second);
+/* A NODE_SEQ block holding `first`; statements are kept in a growable
+   array so a block of N statements is one node, not a chain of N-1. */
+ASTNode* make_block_node(ASTNode* first);
 
-ASTNode* make_type_node(char* type_name);
+/* Appends to a NODE_SEQ or NODE_EXPR_LIST in amortized O(1); returns `list`. */
+ASTNode* list_append(ASTNode* list, ASTNode* item);
+
+/* Removes NULL items and inlines items of nested NODE_SEQ blocks, which
+   are then discarded; returns the number of blocks discarded. */
+size_t block_compact(ASTNode* block);
+
+ASTNode* make_type_node(const char* type_name);
 
 ASTNode* create_node(NodeType type, const char* value);
+
+const char* op_to_str(OpKind op);
+
+const char* get_node_type_str(NodeType type);
 void add_child(ASTNode* parent, ASTNode* child);
-void add_sibling(ASTNode* node, ASTNode* sibling);
 
+/* Links `sibling` after the last node of node's chain and returns the new
+   last node; passing the previous return value keeps appends O(1). */
+ASTNode* add_sibling(ASTNode* node, ASTNode* sibling);
+
+typedef struct {
+    size_t nodes;      /* nodes created since the last free_ast or reset_ast */
+    size_t live;       /* nodes not handed back through discard_ast */
+    size_t bytes;      /* bytes handed out by the arena */
+    size_t reserved;   /* bytes the arena obtained from malloc */
+    size_t shared;     /* constructor calls answered with an existing consed node */
+    size_t created[NODE_TYPE_COUNT];   /* `nodes` by type */
+} AstAllocStats;
+
+/* Releases the calling thread's parse arena: every node it created with
+   create_node goes at once. */
 void free_ast(ASTNode* node);
 
+/* Drops the current tree like free_ast, but keeps the arena blocks and the
+   symbol index for the next parse in the same process. */
+void reset_ast(void);
+
+/* Returns `node` and its children (not node->next) to the allocator for
+   reuse by later constructors; returns the number of nodes reclaimed.
+   Consed nodes are left in place. */
+size_t discard_ast(ASTNode* node);
+
+void ast_alloc_stats(AstAllocStats* stats);
+
 
 void print_ast(ASTNode* node, FILE* output, int indent);
 
+/* print_ast into a caller-owned buffer, so several trees can share it. */
+void write_ast(ASTNode* node, OutBuf* out, int indent);
+
+/* One print_ast line; `number` is the int or OpKind payload, `sym` the
+   symbol (ignored for kinds that do not carry one). */
+void write_node_line(OutBuf* out, size_t depth, NodeType type, int number, const char* sym);
+
+/* The label part of a line, without indentation or newline. With `quoted`
+   set, the symbol is escaped for use inside a double-quoted string. */
+void write_node_label(OutBuf* out, NodeType type, int number, const char* sym, int quoted);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "ast_bin.h"
+#include "ast_soa.h"
+#include "source.h"
+
+
+static const char ast_bin_magic[4] = { 'C', 'A', 'S', 'T' };
+
+
+size_t ast_bin_write(ASTNode* root, OutBuf* out) {
+    size_t start = out->bytes_written;
+    AstBinHeader header;
+    AstSoA soa;
+
+    soa_init(&soa);
+    if (root) {
+        soa_from_tree(&soa, root);
+    }
+
+    memcpy(header.magic, ast_bin_magic, sizeof(header.magic));
+    header.version = AST_BIN_VERSION;
+    header.node_count = (uint32_t)soa.count;
+    header.item_count = (uint32_t)soa.item_count;
+    header.symbol_count = (uint32_t)soa.symbol_count;
+    header.string_bytes = 0;
+    for (size_t i = 0; i < soa.symbol_count; i++) {
+        header.string_bytes += (uint32_t)strlen(soa.symbols[i]) + 1;
+    }
+
+    size_t n = soa.count;
+    outbuf_write(out, (const char*)&header, sizeof(header));
+    outbuf_write(out, (const char*)soa.payload, n * sizeof(int32_t));
+    outbuf_write(out, (const char*)soa.left, n * sizeof(NodeId));
+    outbuf_write(out, (const char*)soa.right, n * sizeof(NodeId));
+    outbuf_write(out, (const char*)soa.next, n * sizeof(NodeId));
+    outbuf_write(out, (const char*)soa.loc, n * sizeof(SrcSpan));
+    outbuf_write(out, (const char*)soa.items, soa.item_count * sizeof(NodeId));
+
+    uint32_t offset = 0;
+    for (size_t i = 0; i <= soa.symbol_count; i++) {
+        outbuf_write(out, (const char*)&offset, sizeof(offset));
+        if (i < soa.symbol_count) {
+            offset += (uint32_t)strlen(soa.symbols[i]) + 1;
+        }
+    }
+
+    outbuf_write(out, (const char*)soa.kind, n);
+    for (size_t i = 0; i < soa.symbol_count; i++) {
+        outbuf_write(out, soa.symbols[i], strlen(soa.symbols[i]) + 1);
+    }
+
+    soa_free(&soa);
+    return out->bytes_written - start;
+}
+
+
+/* A link must point forward to an existing node, which also rules out
+   cycles in a corrupted file. */
+static int valid_link(const AstSoA* soa, size_t from, NodeId to) {
+    return to == SOA_NONE || (to > from && to < soa->count);
+}
+
+
+#define LINK_LEFT  1
+#define LINK_RIGHT 2
+
+
+/* The links each kind may have, and the ones it must have because the
+   passes follow them without a check. An if body or a for part can be
+   missing once dead code is removed. */
+static const unsigned char links_allowed[NODE_TYPE_COUNT] = {
+    [NODE_DECL] = LINK_LEFT,
+    [NODE_BINOP] = LINK_LEFT | LINK_RIGHT,
+    [NODE_UNARY] = LINK_LEFT,
+    [NODE_FUNC_CALL] = LINK_LEFT,
+    [NODE_FUNC_DEF] = LINK_LEFT,
+    [NODE_IF] = LINK_LEFT | LINK_RIGHT,
+    [NODE_FOR] = LINK_LEFT | LINK_RIGHT,
+    [NODE_RETURN] = LINK_LEFT
+};
+
+static const unsigned char links_required[NODE_TYPE_COUNT] = {
+    [NODE_BINOP] = LINK_LEFT | LINK_RIGHT,
+    [NODE_UNARY] = LINK_LEFT,
+    [NODE_FUNC_DEF] = LINK_LEFT,
+    [NODE_IF] = LINK_LEFT,
+    [NODE_RETURN] = LINK_LEFT
+};
+
+
+/* Counts one more link into `to`, stopping at 2. */
+static void add_parent(unsigned char* parents, NodeId to) {
+    if (to != SOA_NONE && parents[to] < 2) parents[to]++;
+}
+
+
+static int valid_soa_node(const AstSoA* soa, size_t i, unsigned char* parents) {
+    int32_t payload = soa->payload[i];
+
+    if (soa->kind[i] > NODE_TYPE) return 0;
+    if (!valid_link(soa, i, soa->left[i]) ||
+        !valid_link(soa, i, soa->right[i]) ||
+        !valid_link(soa, i, soa->next[i])) {
+        return 0;
+    }
+
+    unsigned links = (soa->left[i] != SOA_NONE ? LINK_LEFT : 0) |
+                     (soa->right[i] != SOA_NONE ? LINK_RIGHT : 0);
+    if ((links & ~links_allowed[soa->kind[i]]) ||
+        (links_required[soa->kind[i]] & ~links)) {
+        return 0;
+    }
+    add_parent(parents, soa->left[i]);
+    add_parent(parents, soa->right[i]);
+    add_parent(parents, soa->next[i]);
+
+    switch ((NodeType)soa->kind[i]) {
+        case NODE_INT:
+            break;
+        case NODE_BINOP:
+        case NODE_UNARY:
+            if (payload < OP_ADD || payload > OP_DEC) return 0;
+            break;
+        case NODE_SEQ:
+        case NODE_EXPR_LIST:
+            if (payload < 0 || (size_t)payload >= soa->item_count) return 0;
+            if (soa->items[payload] > soa->item_count - (size_t)payload - 1) return 0;
+            for (NodeId j = 0; j < soa->items[payload]; j++) {
+                NodeId item = soa->items[payload + 1 + j];
+                if (item == SOA_NONE || !valid_link(soa, i, item)) return 0;
+                add_parent(parents, item);
+            }
+            break;
+        default:
+            if (payload < -1 || payload >= (int32_t)soa->symbol_count) return 0;
+            break;
+    }
+    return 1;
+}
+
+
+/* Besides checking each node, requires a tree: every node but the first
+   function is reached by exactly one link, or the rebuilt nodes would be
+   shared and freed twice. */
+static int valid_soa(const AstSoA* soa) {
+    unsigned char* parents = (unsigned char*)calloc(soa->count, 1);
+    if (!parents) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    int ok = 1;
+    for (size_t i = 0; i < soa->count && ok; i++) {
+        ok = valid_soa_node(soa, i, parents);
+    }
+    for (size_t i = 0; i < soa->count && ok; i++) {
+        ok = parents[i] == (i > 0);
+    }
+
+    free(parents);
+    return ok;
+}
+
+
+ASTNode* ast_bin_read(const char* data, size_t size) {
+    AstBinHeader header;
+
+    if (size < sizeof(header)) return NULL;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, ast_bin_magic, sizeof(header.magic)) != 0 ||
+        header.version != AST_BIN_VERSION || header.node_count == 0) {
+        return NULL;
+    }
+
+    size_t n = header.node_count;
+    size_t words = 6 * n + header.item_count + header.symbol_count + 1;
+    if (size != sizeof(header) + words * sizeof(uint32_t) + n + header.string_bytes) {
+        return NULL;
+    }
+
+    /* The arrays are used in place; soa_to_tree only reads them. */
+    AstSoA soa;
+    uint32_t* word = (uint32_t*)(data + sizeof(header));
+    soa_init(&soa);
+    soa.count = n;
+    soa.payload = (int32_t*)word;
+    soa.left = word + n;
+    soa.right = word + 2 * n;
+    soa.next = word + 3 * n;
+    soa.loc = (SrcSpan*)(word + 4 * n);
+    soa.items = word + 6 * n;
+    soa.item_count = header.item_count;
+
+    const uint32_t* offsets = word + 6 * n + header.item_count;
+    soa.kind = (uint8_t*)(offsets + header.symbol_count + 1);
+    const char* strings = (const char*)soa.kind + n;
+
+    if (offsets[0] != 0 || offsets[header.symbol_count] != header.string_bytes) return NULL;
+
+    soa.symbol_count = header.symbol_count;
+    soa.symbols = (const char**)malloc((soa.symbol_count + 1) * sizeof(const char*));
+    if (!soa.symbols) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < soa.symbol_count; i++) {
+        if (offsets[i + 1] <= offsets[i] || offsets[i + 1] > header.string_bytes ||
+            strings[offsets[i + 1] - 1] != '\0') {
+            free(soa.symbols);
+            return NULL;
+        }
+        soa.symbols[i] = strings + offsets[i];
+    }
+
+    /* create_node interns the symbols, so nothing in the tree points into
+       `data` afterwards. */
+    ASTNode* root = valid_soa(&soa) ? soa_to_tree(&soa) : NULL;
+    free(soa.symbols);
+    return root;
+}
+
+
+int ast_bin_save(ASTNode* root, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return 0;
+
+    OutBuf out;
+    outbuf_init(&out, file);
+    ast_bin_write(root, &out);
+    outbuf_close(&out);
+
+    int ok = !ferror(file);
+    if (fclose(file) != 0) ok = 0;
+    return ok;
+}
+
+
+ASTNode* ast_bin_load(const char* path) {
+    SourceBuffer src;
+
+    if (!source_open(&src, path)) return NULL;
+    ASTNode* root = ast_bin_read(src.data, src.size);
+    source_close(&src);
+    errno = 0;
+    return root;
+}
@@ -0,0 +1,43 @@
+#ifndef AST_BIN_H
+#define AST_BIN_H
+
+#include <stdint.h>
+#include "ast.h"
+#include "outbuf.h"
+
+
+#define AST_BIN_VERSION 1
+
+
+/* Binary form of an AST, so a tree can be loaded without parsing. The
+   header is followed by the AstSoA arrays back to back, in native byte
+   order: payload, left, right, next and loc per node, the list items,
+   then symbol_count + 1 string offsets, the node kinds and the
+   NUL-terminated symbol strings. Every section but the last two is made
+   of 4-byte words, so a mapped file can be read in place. */
+typedef struct {
+    char magic[4];           /* "CAST" */
+    uint32_t version;
+    uint32_t node_count;
+    uint32_t item_count;
+    uint32_t symbol_count;
+    uint32_t string_bytes;
+} AstBinHeader;
+
+
+/* Serializes the tree rooted at `root` (and root->next); returns the
+   number of bytes written. */
+size_t ast_bin_write(ASTNode* root, OutBuf* out);
+
+/* Rebuilds a tree in the calling thread's AST arena from data[0..size).
+   Returns NULL if the data is not a well-formed serialized tree. */
+ASTNode* ast_bin_read(const char* data, size_t size);
+
+/* ast_bin_write to a file; returns 0 and sets errno on failure. */
+int ast_bin_save(ASTNode* root, const char* path);
+
+/* Maps `path` and reads it with ast_bin_read. Returns NULL on failure;
+   errno is then 0 if the file was read but is not a serialized tree. */
+ASTNode* ast_bin_load(const char* path);
+
+#endif
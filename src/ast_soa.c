@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ast_soa.h"
+#include "walk.h"
+
+
+typedef struct {
+    AstSoA* soa;
+    NodeId last_root;
+} SoaBuild;
+
+
+static void* xrealloc(void* ptr, size_t size) {
+    void* result = realloc(ptr, size);
+    if (!result) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    return result;
+}
+
+
+void soa_init(AstSoA* soa) {
+    memset(soa, 0, sizeof(*soa));
+}
+
+
+void soa_free(AstSoA* soa) {
+    free(soa->kind);
+    free(soa->payload);
+    free(soa->left);
+    free(soa->right);
+    free(soa->next);
+    free(soa->depth);
+    free(soa->loc);
+    free(soa->items);
+    free(soa->symbols);
+    symmap_clear(&soa->symbol_ids);
+    soa_init(soa);
+}
+
+
+static void soa_reserve(AstSoA* soa, size_t count) {
+    if (count <= soa->capacity) return;
+
+    size_t capacity = soa->capacity ? soa->capacity * 2 : 1024;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    soa->kind = (uint8_t*)xrealloc(soa->kind, capacity * sizeof(uint8_t));
+    soa->payload = (int32_t*)xrealloc(soa->payload, capacity * sizeof(int32_t));
+    soa->left = (NodeId*)xrealloc(soa->left, capacity * sizeof(NodeId));
+    soa->right = (NodeId*)xrealloc(soa->right, capacity * sizeof(NodeId));
+    soa->next = (NodeId*)xrealloc(soa->next, capacity * sizeof(NodeId));
+    soa->depth = (uint32_t*)xrealloc(soa->depth, capacity * sizeof(uint32_t));
+    soa->loc = (SrcSpan*)xrealloc(soa->loc, capacity * sizeof(SrcSpan));
+    soa->capacity = capacity;
+}
+
+
+static size_t soa_reserve_items(AstSoA* soa, unsigned count) {
+    size_t offset = soa->item_count;
+    size_t needed = offset + 1 + count;
+
+    if (needed > soa->item_capacity) {
+        size_t capacity = soa->item_capacity ? soa->item_capacity * 2 : 1024;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        soa->items = (NodeId*)xrealloc(soa->items, capacity * sizeof(NodeId));
+        soa->item_capacity = capacity;
+    }
+
+    soa->items[offset] = count;
+    for (unsigned i = 0; i < count; i++) {
+        soa->items[offset + 1 + i] = SOA_NONE;
+    }
+    soa->item_count = needed;
+    return offset;
+}
+
+
+static int32_t soa_symbol(AstSoA* soa, const char* sym) {
+    if (!sym) return -1;
+
+    SymSlot* slot = symmap_insert(&soa->symbol_ids, sym, -1);
+    if (slot->value < 0) {
+        if (soa->symbol_count == soa->symbol_capacity) {
+            soa->symbol_capacity = soa->symbol_capacity ? soa->symbol_capacity * 2 : 256;
+            soa->symbols = (const char**)xrealloc(soa->symbols, soa->symbol_capacity * sizeof(const char*));
+        }
+        soa->symbols[soa->symbol_count] = sym;
+        slot->value = (int)soa->symbol_count++;
+    }
+    return slot->value;
+}
+
+
+static WalkAction soa_add_node(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    SoaBuild* build = (SoaBuild*)ctx;
+    AstSoA* soa = build->soa;
+    ASTNode* node = frame->node;
+    NodeId id = (NodeId)frame->order;
+
+    soa_reserve(soa, id + 1);
+    soa->count = id + 1;
+    soa->kind[id] = (uint8_t)node->type;
+    soa->left[id] = SOA_NONE;
+    soa->right[id] = SOA_NONE;
+    soa->next[id] = SOA_NONE;
+    soa->depth[id] = (uint32_t)frame->depth;
+    soa->loc[id] = node->loc;
+
+    switch (node->type) {
+        case NODE_INT:
+            soa->payload[id] = node->value.ival;
+            break;
+        case NODE_BINOP:
+        case NODE_UNARY:
+            soa->payload[id] = (int32_t)node->value.op;
+            break;
+        case NODE_SEQ:
+        case NODE_EXPR_LIST:
+            soa->payload[id] = (int32_t)soa_reserve_items(soa, node->count);
+            break;
+        default:
+            soa->payload[id] = soa_symbol(soa, node->value.sym);
+            break;
+    }
+
+    /* The parent frame's data holds the ID of its most recent child-level
+       node, which is the predecessor when we arrived through a next link. */
+    WalkFrame* parent = walk_parent(walker, frame);
+    if (!parent) {
+        if (build->last_root != SOA_NONE) {
+            soa->next[build->last_root] = id;
+        }
+        build->last_root = id;
+        return WALK_CONTINUE;
+    }
+
+    NodeId pid = (NodeId)parent->order;
+    if (frame->item) {
+        soa->items[soa->payload[pid] + frame->item] = id;
+    } else if (frame->link == &parent->node->left) {
+        soa->left[pid] = id;
+    } else if (frame->link == &parent->node->right) {
+        soa->right[pid] = id;
+    } else {
+        soa->next[parent->data] = id;
+    }
+    parent->data = id;
+
+    return WALK_CONTINUE;
+}
+
+
+void soa_from_tree(AstSoA* soa, ASTNode* root) {
+    SoaBuild build = { soa, SOA_NONE };
+    AstWalker walker;
+
+    soa->count = 0;
+    soa->item_count = 0;
+
+    walker_init(&walker);
+    ast_walk(&walker, &root, soa_add_node, NULL, &build);
+    walker_free(&walker);
+}
+
+
+ASTNode* soa_to_tree(const AstSoA* soa) {
+    if (!soa->count) return NULL;
+
+    ASTNode** nodes = (ASTNode**)calloc(soa->count, sizeof(ASTNode*));
+    if (!nodes) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < soa->count; i++) {
+        NodeType type = (NodeType)soa->kind[i];
+        int32_t payload = soa->payload[i];
+
+        if (soa->kind[i] == SOA_DEAD) continue;
+
+        switch (type) {
+            case NODE_INT:
+                /* Not consed: a rebuilt chain of functions shares no nodes. */
+                nodes[i] = create_node(type, NULL);
+                nodes[i]->value.ival = payload;
+                break;
+            case NODE_BINOP:
+            case NODE_UNARY:
+                nodes[i] = create_node(type, NULL);
+                nodes[i]->value.op = (OpKind)payload;
+                break;
+            case NODE_SEQ:
+            case NODE_EXPR_LIST:
+                nodes[i] = create_node(type, NULL);
+                break;
+            default:
+                nodes[i] = create_node(type, payload < 0 ? NULL : soa->symbols[payload]);
+                break;
+        }
+        nodes[i]->loc = soa->loc[i];
+    }
+
+    /* Children have larger IDs, so every link target exists by now. */
+    for (size_t i = 0; i < soa->count; i++) {
+        ASTNode* node = nodes[i];
+        if (!node) continue;
+
+        if (soa->left[i] != SOA_NONE) node->left = nodes[soa->left[i]];
+        if (soa->right[i] != SOA_NONE) node->right = nodes[soa->right[i]];
+        if (soa->next[i] != SOA_NONE) node->next = nodes[soa->next[i]];
+
+        if (AST_HAS_ITEMS(node)) {
+            const NodeId* items = &soa->items[soa->payload[i]];
+            for (NodeId j = 0; j < items[0]; j++) {
+                list_append(node, nodes[items[1 + j]]);
+            }
+        }
+    }
+
+    ASTNode* root = nodes[0];
+    free(nodes);
+    return root;
+}
+
+
+void soa_fold_constants(AstSoA* soa, PassStats* stats) {
+    double start = pass_time_ms();
+    int result;
+
+    stats->name = "soa-folding";
+    stats->nodes_folded = 0;
+    stats->nodes_freed = 0;
+    stats->evals_removed = 0;
+
+    for (size_t i = soa->count; i-- > 0;) {
+        if (soa->kind[i] != NODE_BINOP) continue;
+
+        NodeId l = soa->left[i];
+        NodeId r = soa->right[i];
+        if (soa->kind[l] != NODE_INT || soa->kind[r] != NODE_INT) continue;
+        if (!eval_binop((OpKind)soa->payload[i], soa->payload[l], soa->payload[r], &result)) continue;
+
+        soa->kind[i] = NODE_INT;
+        soa->payload[i] = result;
+        soa->left[i] = SOA_NONE;
+        soa->right[i] = SOA_NONE;
+        soa->kind[l] = SOA_DEAD;
+        soa->kind[r] = SOA_DEAD;
+        stats->nodes_folded++;
+        stats->nodes_freed += 2;
+    }
+
+    stats->elapsed_ms = pass_time_ms() - start;
+}
+
+
+void soa_print(const AstSoA* soa, OutBuf* out) {
+    for (size_t i = 0; i < soa->count; i++) {
+        if (soa->kind[i] == SOA_DEAD) continue;
+
+        NodeType type = (NodeType)soa->kind[i];
+        int32_t payload = soa->payload[i];
+        const char* sym = NULL;
+
+        if (type != NODE_INT && type != NODE_BINOP && type != NODE_UNARY &&
+            type != NODE_SEQ && type != NODE_EXPR_LIST && payload >= 0) {
+            sym = soa->symbols[payload];
+        }
+        write_node_line(out, soa->depth[i], type, payload, sym);
+    }
+}
+
+
+size_t soa_bytes(const AstSoA* soa) {
+    size_t per_node = sizeof(uint8_t) + sizeof(int32_t) + 3 * sizeof(NodeId) + sizeof(uint32_t) +
+                      sizeof(SrcSpan);
+    return soa->count * per_node + soa->item_count * sizeof(NodeId) +
+           soa->symbol_count * sizeof(const char*);
+}
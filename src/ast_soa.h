@@ -0,0 +1,62 @@
+#ifndef AST_SOA_H
+#define AST_SOA_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "ast.h"
+#include "optimize.h"
+#include "symmap.h"
+
+
+typedef uint32_t NodeId;
+
+#define SOA_NONE ((NodeId)0xFFFFFFFFu)
+
+/* Kind of a node dropped by a pass over the arrays; such nodes are skipped. */
+#define SOA_DEAD 0xFF
+
+
+/* Structure-of-arrays copy of an AST. Node IDs are assigned in print_ast
+   order (pre-order: node, left chain, right chain, list items, then next),
+   so every child has a larger ID than its parent: a forward scan visits
+   nodes in print order and a backward scan visits children first. */
+typedef struct {
+    size_t count;
+    size_t capacity;
+    uint8_t* kind;
+    int32_t* payload;      /* ival, op, symbol index (-1 for none) or items offset */
+    NodeId* left;
+    NodeId* right;
+    NodeId* next;
+    uint32_t* depth;       /* print indentation level */
+    SrcSpan* loc;
+
+    NodeId* items;         /* per list: count, then that many child IDs */
+    size_t item_count;
+    size_t item_capacity;
+
+    const char** symbols;  /* interned strings, owned by the parse arena */
+    size_t symbol_count;
+    size_t symbol_capacity;
+    SymMap symbol_ids;
+} AstSoA;
+
+
+void soa_init(AstSoA* soa);
+
+void soa_free(AstSoA* soa);
+
+void soa_from_tree(AstSoA* soa, ASTNode* root);
+
+/* Rebuilds an ASTNode tree with the regular constructors. */
+ASTNode* soa_to_tree(const AstSoA* soa);
+
+/* Folds constant NODE_BINOP nodes with one backward scan. */
+void soa_fold_constants(AstSoA* soa, PassStats* stats);
+
+/* Same output as print_ast, produced by one forward scan. */
+void soa_print(const AstSoA* soa, OutBuf* out);
+
+size_t soa_bytes(const AstSoA* soa);
+
+#endif
@@ -0,0 +1,498 @@
+/* Benchmark for the whole pipeline on generated programs.
+
+   Built on its own, from every source but main.c and input.c:
+       cc -O2 -o bench bench.c $(ls *.c | grep -v -e '^main.c$' -e '^input.c$' -e '^bench.c$') -lpthread
+   Each size gets a fresh program in the grammar of parser.y, which is then
+   parsed as the tool does it, scanned and parsed again as separate
+   phases, optimized, printed and freed, with the time,
+   throughput and peak resident set size of each phase reported. The
+   tree is also converted to its structure-of-arrays form (ast_soa.h),
+   which is folded and printed by linear scans next to the pointer
+   passes. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/resource.h>
+#include "ast.h"
+#include "ast_soa.h"
+#include "optimize.h"
+#include "outbuf.h"
+#include "parse.h"
+
+
+typedef struct {
+    size_t statements;       /* per program */
+    size_t per_function;     /* statements per function */
+    int nesting;             /* deepest if/for nesting */
+    int expr_depth;          /* most operators in one expression */
+    uint64_t seed;
+    const char* save;        /* write the last program here */
+} BenchConfig;
+
+
+/* Program text being generated, with the two NUL bytes flex wants after
+   a buffer it scans in place. */
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+    uint64_t state;
+    const BenchConfig* config;
+    size_t statements;       /* generated so far */
+    size_t functions;
+    unsigned* scope;         /* numbers of the variables in scope */
+    size_t scope_count;
+    size_t scope_capacity;
+    unsigned next_var;       /* declared so far in this function */
+} Gen;
+
+
+typedef struct {
+    const char* name;
+    double ms;
+    double amount;           /* units processed, for the throughput */
+    const char* unit;
+    long peak_kb;
+} Phase;
+
+
+static void gen_reserve(Gen* g, size_t len) {
+    if (g->size + len + 2 <= g->capacity) return;
+
+    while (g->size + len + 2 > g->capacity) {
+        g->capacity = g->capacity ? g->capacity * 2 : 1 << 20;
+    }
+    g->data = (char*)realloc(g->data, g->capacity);
+    if (!g->data) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+}
+
+
+static void gen_write(Gen* g, const char* text, size_t len) {
+    gen_reserve(g, len);
+    memcpy(g->data + g->size, text, len);
+    g->size += len;
+}
+
+
+static void gen_puts(Gen* g, const char* text) {
+    gen_write(g, text, strlen(text));
+}
+
+
+static void gen_printf(Gen* g, const char* format, unsigned value) {
+    char text[64];
+    int len = snprintf(text, sizeof(text), format, value);
+    gen_write(g, text, (size_t)len);
+}
+
+
+static void gen_indent(Gen* g, int depth) {
+    for (int i = 0; i <= depth; i++) {
+        gen_write(g, "    ", 4);
+    }
+}
+
+
+/* xorshift64*: fast, and the same program for the same seed everywhere. */
+static unsigned gen_rand(Gen* g, unsigned bound) {
+    g->state ^= g->state >> 12;
+    g->state ^= g->state << 25;
+    g->state ^= g->state >> 27;
+    return (unsigned)((g->state * 0x2545F4914F6CDD1Dull) >> 33) % bound;
+}
+
+
+static void gen_leaf(Gen* g) {
+    if (g->scope_count && gen_rand(g, 3)) {
+        gen_printf(g, "v%u", g->scope[gen_rand(g, (unsigned)g->scope_count)]);
+    } else {
+        gen_printf(g, "%u", 1 + gen_rand(g, 999));
+    }
+}
+
+
+/* The grammar has no parentheses, so depth comes from operator chains
+   (which precedence turns into trees) and call arguments. */
+static void gen_expr(Gen* g, int depth) {
+    static const char* const ops[] = { " + ", " - ", " * ", " / ", " < " };
+    unsigned count = depth > 0 ? gen_rand(g, (unsigned)depth + 1) : 0;
+
+    if (depth > 1 && gen_rand(g, 8) == 0) {
+        gen_puts(g, "f(");
+        gen_expr(g, depth - 1);
+        gen_puts(g, ", ");
+        gen_expr(g, depth - 1);
+        gen_puts(g, ")");
+    } else {
+        gen_leaf(g);
+    }
+    for (unsigned i = 0; i < count; i++) {
+        gen_puts(g, ops[gen_rand(g, 5)]);
+        gen_leaf(g);
+    }
+}
+
+
+static void gen_block(Gen* g, int depth, size_t budget);
+
+
+static void gen_stmt(Gen* g, int depth, size_t* budget) {
+    unsigned kind = gen_rand(g, depth < g->config->nesting && *budget > 2 ? 10 : 7);
+    int expr_depth = g->config->expr_depth;
+
+    g->statements++;
+    (*budget)--;
+    gen_indent(g, depth);
+
+    if (kind < 4 || !g->scope_count) {
+        gen_printf(g, "int v%u = ", g->next_var);
+        gen_expr(g, expr_depth);
+        gen_puts(g, ";\n");
+        /* Names are not reused within a function, so no declaration
+           shadows another. */
+        if (g->scope_count == g->scope_capacity) {
+            g->scope_capacity = g->scope_capacity ? g->scope_capacity * 2 : 256;
+            g->scope = (unsigned*)realloc(g->scope, g->scope_capacity * sizeof(unsigned));
+            if (!g->scope) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(1);
+            }
+        }
+        g->scope[g->scope_count++] = g->next_var++;
+    } else if (kind < 6) {
+        gen_puts(g, "print(");
+        gen_expr(g, expr_depth);
+        gen_puts(g, ", ");
+        gen_expr(g, expr_depth);
+        gen_puts(g, ");\n");
+    } else if (kind < 7) {
+        gen_printf(g, "v%u++;\n", g->scope[gen_rand(g, (unsigned)g->scope_count)]);
+    } else {
+        size_t inner = 1 + gen_rand(g, (unsigned)(*budget < 8 ? *budget : 8));
+        *budget -= inner;
+        if (kind < 9) {
+            gen_puts(g, "if (");
+            gen_expr(g, expr_depth);
+            gen_puts(g, ") {\n");
+        } else {
+            gen_printf(g, "for (int i%u = 0; ", (unsigned)depth);
+            gen_printf(g, "i%u < ", (unsigned)depth);
+            gen_expr(g, expr_depth);
+            gen_printf(g, "; i%u++) {\n", (unsigned)depth);
+        }
+        gen_block(g, depth + 1, inner);
+        gen_indent(g, depth);
+        gen_puts(g, "}\n");
+    }
+}
+
+
+static void gen_block(Gen* g, int depth, size_t budget) {
+    size_t scope_count = g->scope_count;
+
+    while (budget) {
+        gen_stmt(g, depth, &budget);
+    }
+    /* Names declared in the block go out of scope with it. */
+    g->scope_count = scope_count;
+}
+
+
+static void generate(Gen* g, const BenchConfig* config) {
+    g->size = 0;
+    g->state = config->seed ? config->seed : 1;
+    g->config = config;
+    g->statements = 0;
+    g->functions = 0;
+
+    while (g->statements < config->statements) {
+        size_t budget = config->statements - g->statements;
+        if (budget > config->per_function) budget = config->per_function;
+
+        g->scope_count = 0;
+        g->next_var = 0;
+        gen_printf(g, "int f%u() {\n", (unsigned)g->functions++);
+        if (budget > 1) gen_block(g, 0, budget - 1);
+        g->statements++;
+        gen_puts(g, "    return ");
+        gen_expr(g, config->expr_depth);
+        gen_puts(g, ";\n}\n\n");
+    }
+
+    gen_reserve(g, 0);
+    g->data[g->size] = '\0';
+    g->data[g->size + 1] = '\0';
+}
+
+
+/* Linux keeps the peak resident set size in VmHWM, and writing 5 to
+   clear_refs resets it, which gives each phase a peak of its own.
+   Elsewhere the process-wide peak from getrusage is all there is. */
+static void reset_peak_rss(void) {
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if (!file) return;
+    fputs("5", file);
+    fclose(file);
+}
+
+
+static long peak_rss_kb(void) {
+    FILE* file = fopen("/proc/self/status", "r");
+    char line[256];
+    long kb = -1;
+
+    if (file) {
+        while (fgets(line, sizeof(line), file)) {
+            if (strncmp(line, "VmHWM:", 6) == 0) {
+                kb = strtol(line + 6, NULL, 10);
+                break;
+            }
+        }
+        fclose(file);
+    }
+    if (kb < 0) {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        kb = usage.ru_maxrss;
+    }
+    return kb;
+}
+
+
+static void phase_begin(Phase* phase, const char* name) {
+    phase->name = name;
+    reset_peak_rss();
+    phase->ms = pass_time_ms();
+}
+
+
+static void phase_end(Phase* phase, double amount, const char* unit) {
+    phase->ms = pass_time_ms() - phase->ms;
+    phase->amount = amount;
+    phase->unit = unit;
+    phase->peak_kb = peak_rss_kb();
+}
+
+
+static void print_phase(const Phase* phase) {
+    double rate = phase->ms > 0 ? phase->amount * 1000.0 / phase->ms : 0.0;
+    printf("  %-18s %10.3f ms %10.2f %-9s %9.1f MB peak\n", phase->name, phase->ms,
+           rate, phase->unit, phase->peak_kb / 1024.0);
+}
+
+
+static void print_pass(const PassStats* stats, size_t nodes) {
+    double rate = stats->elapsed_ms > 0 ? nodes / (stats->elapsed_ms * 1000.0) : 0.0;
+    printf("    %-16s %10.3f ms %10.2f %-9s\n", stats->name, stats->elapsed_ms, rate, "Mnodes/s");
+}
+
+
+/* Runs every phase over one generated program; returns 0 if it failed
+   to parse, which would be a generator bug. */
+static int run_size(Gen* g, Parser* parser, const BenchConfig* config, FILE* sink) {
+    Phase phases[6];
+    Phase soa_phases[2];
+    TokenBuffer tokens;
+    AstSoA soa;
+    double mb = 0;
+
+    generate(g, config);
+    mb = (double)g->size / 1e6;
+    if (config->save) {
+        FILE* file = fopen(config->save, "w");
+        if (!file) {
+            perror(config->save);
+        } else {
+            fwrite(g->data, 1, g->size, file);
+            fclose(file);
+        }
+    }
+
+    /* As the tool parses by default, pulling tokens from the scanner. */
+    phase_begin(&phases[2], "lex+parse");
+    ASTNode* root = parser_parse_buffer(parser, g->data, g->size, "bench");
+    phase_end(&phases[2], mb, "MB/s");
+    reset_ast();
+    if (!root) return 0;
+
+    token_buffer_init(&tokens);
+    phase_begin(&phases[0], "lex");
+    size_t token_count = parser_tokenize(parser, g->data, g->size, "bench", &tokens);
+    phase_end(&phases[0], mb, "MB/s");
+
+    phase_begin(&phases[1], "parse");
+    root = parser_parse_tokens(parser, &tokens, g->data, "bench");
+    phase_end(&phases[1], mb, "MB/s");
+    token_buffer_free(&tokens);
+    if (!root) return 0;
+
+    AstAllocStats alloc;
+    ast_alloc_stats(&alloc);
+    size_t nodes = alloc.nodes;
+
+    /* The arrays are folded from the parsed tree, as fold_constants is.
+       Folding them only merges constant operators; it does not propagate. */
+    PassStats soa_fold;
+    soa_init(&soa);
+    phase_begin(&soa_phases[0], "soa_from_tree");
+    soa_from_tree(&soa, root);
+    phase_end(&soa_phases[0], (double)nodes / 1e6, "Mnodes/s");
+    soa_fold_constants(&soa, &soa_fold);
+    soa_free(&soa);
+
+    PassStats passes[3];
+    phase_begin(&phases[3], "optimize");
+    fold_constants(root, &passes[0]);
+    eliminate_dead_code(root, &passes[1]);
+    eliminate_common_subexpressions(root, &passes[2]);
+    phase_end(&phases[3], (double)nodes / 1e6, "Mnodes/s");
+
+    OutBuf out;
+    outbuf_init(&out, sink);
+    phase_begin(&phases[4], "print_ast");
+    write_ast(root, &out, 0);
+    outbuf_flush(&out);
+    phase_end(&phases[4], (double)out.bytes_written / 1e6, "MB/s");
+    size_t printed = out.bytes_written;
+    outbuf_close(&out);
+
+    /* The optimized tree again as arrays, to print the same text. */
+    soa_init(&soa);
+    soa_from_tree(&soa, root);
+    size_t soa_size = soa_bytes(&soa);
+    outbuf_init(&out, sink);
+    phase_begin(&soa_phases[1], "soa_print");
+    soa_print(&soa, &out);
+    outbuf_flush(&out);
+    phase_end(&soa_phases[1], (double)out.bytes_written / 1e6, "MB/s");
+    if (out.bytes_written != printed) {
+        fprintf(stderr, "bench: soa_print wrote %zu bytes, print_ast %zu\n", out.bytes_written, printed);
+    }
+    outbuf_close(&out);
+    soa_free(&soa);
+
+    ast_alloc_stats(&alloc);
+    phase_begin(&phases[5], "free_ast");
+    free_ast(root);
+    phase_end(&phases[5], (double)alloc.nodes / 1e6, "Mnodes/s");
+
+    printf("%zu statements in %zu functions: %.2f MB, %zu tokens, %zu nodes\n",
+           g->statements, g->functions, mb, token_count, nodes);
+    for (int i = 0; i < 4; i++) {
+        print_phase(&phases[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        print_pass(&passes[i], nodes);
+    }
+    print_phase(&phases[4]);
+    print_phase(&phases[5]);
+
+    /* Strings stay in the AST arena either way, so they are left out of
+       the array size. */
+    printf("as arrays: %.2f MB, against %.2f MB of arena for the tree\n",
+           soa_size / 1e6, alloc.bytes / 1e6);
+    print_phase(&soa_phases[0]);
+    print_pass(&soa_fold, nodes);
+    print_phase(&soa_phases[1]);
+    return 1;
+}
+
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [options] [statements ...]\n"
+            "  -f N        statements per function (default 1000)\n"
+            "  -d N        deepest if/for nesting (default 3)\n"
+            "  -e N        most operators per expression (default 4)\n"
+            "  -s N        random seed (default 1)\n"
+            "  -o FILE     also write the last generated program to FILE\n"
+            "  -l NAME     lex with flex (default) or simd\n"
+            "Sizes may end in K or M; the default is 1K 10K 100K 1M.\n",
+            prog);
+}
+
+
+static size_t parse_size(const char* text) {
+    char* end;
+    size_t size = strtoul(text, &end, 10);
+    if (*end == 'k' || *end == 'K') size *= 1000;
+    if (*end == 'm' || *end == 'M') size *= 1000000;
+    return size;
+}
+
+
+int main(int argc, char** argv) {
+    BenchConfig config = { 0, 1000, 3, 4, 1, NULL };
+    size_t sizes[64];
+    size_t size_count = 0;
+    LexerKind lexer = LEXER_FLEX;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+
+        if (arg[0] != '-') {
+            if (size_count < sizeof(sizes) / sizeof(sizes[0])) {
+                sizes[size_count++] = parse_size(arg);
+            }
+        } else if (i + 1 == argc) {
+            usage(argv[0]);
+            return 1;
+        } else if (strcmp(arg, "-f") == 0) {
+            config.per_function = parse_size(argv[++i]);
+        } else if (strcmp(arg, "-d") == 0) {
+            config.nesting = atoi(argv[++i]);
+        } else if (strcmp(arg, "-e") == 0) {
+            config.expr_depth = atoi(argv[++i]);
+        } else if (strcmp(arg, "-s") == 0) {
+            config.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "-o") == 0) {
+            config.save = argv[++i];
+        } else if (strcmp(arg, "-l") == 0) {
+            const char* name = argv[++i];
+            if (strcmp(name, "simd") == 0) {
+                lexer = LEXER_SIMD;
+            } else if (strcmp(name, "flex") != 0) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (config.per_function == 0) config.per_function = 1;
+
+    if (size_count == 0) {
+        static const size_t defaults[] = { 1000, 10000, 100000, 1000000 };
+        size_count = sizeof(defaults) / sizeof(defaults[0]);
+        memcpy(sizes, defaults, sizeof(defaults));
+    }
+
+    FILE* sink = fopen("/dev/null", "w");
+    if (!sink) {
+        perror("/dev/null");
+        return 1;
+    }
+
+    Gen gen = { NULL, 0, 0, 0, NULL, 0, 0, NULL, 0, 0, 0 };
+    Parser parser;
+    int ok = 1;
+    parser_init(&parser);
+    parser.lexer = lexer;
+    for (size_t i = 0; i < size_count && ok; i++) {
+        config.statements = sizes[i];
+        ok = run_size(&gen, &parser, &config, sink);
+        if (!ok) fprintf(stderr, "bench: generated program failed to parse\n");
+    }
+    parser_free(&parser);
+    free_ast(NULL);
+    free(gen.data);
+    free(gen.scope);
+    fclose(sink);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "cache.h"
+#include "ast_bin.h"
+#include "outbuf.h"
+#include "optimize.h"
+
+
+#define PRIME1 0x9E3779B185EBCA87ull
+#define PRIME2 0xC2B2AE3D27D4EB4Full
+#define PRIME3 0x165667B19E3779F9ull
+#define PRIME4 0x85EBCA77C2B2AE63ull
+#define PRIME5 0x27D4EB2F165667C5ull
+
+
+static uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+
+static uint64_t read64(const char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+
+static uint64_t hash_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME2;
+    return rotl64(acc, 31) * PRIME1;
+}
+
+
+static uint64_t hash_merge(uint64_t acc, uint64_t lane) {
+    acc ^= hash_round(0, lane);
+    return acc * PRIME1 + PRIME4;
+}
+
+
+/* xxHash64-style: four independent lanes over 32-byte stripes keep
+   several multiplies in flight, so hashing runs near memory speed. */
+static uint64_t hash_bytes(const char* data, size_t size) {
+    const char* p = data;
+    const char* end = data + size;
+    uint64_t h;
+
+    if (size >= 32) {
+        uint64_t v1 = PRIME1 + PRIME2;
+        uint64_t v2 = PRIME2;
+        uint64_t v3 = 0;
+        uint64_t v4 = 0 - PRIME1;
+
+        for (; end - p >= 32; p += 32) {
+            v1 = hash_round(v1, read64(p));
+            v2 = hash_round(v2, read64(p + 8));
+            v3 = hash_round(v3, read64(p + 16));
+            v4 = hash_round(v4, read64(p + 24));
+        }
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = hash_merge(h, v1);
+        h = hash_merge(h, v2);
+        h = hash_merge(h, v3);
+        h = hash_merge(h, v4);
+    } else {
+        h = PRIME5;
+    }
+
+    h += (uint64_t)size;
+    for (; end - p >= 8; p += 8) {
+        h ^= hash_round(0, read64(p));
+        h = rotl64(h, 27) * PRIME1 + PRIME4;
+    }
+    for (; p < end; p++) {
+        h ^= (unsigned char)*p * PRIME5;
+        h = rotl64(h, 11) * PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+
+CacheKey cache_key(const char* data, size_t size) {
+    CacheKey key;
+    key.hash = hash_bytes(data, size);
+    key.size = size;
+    return key;
+}
+
+
+int parse_cache_init(ParseCache* cache, const char* dir, int hash_cons) {
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST) return 0;
+
+    cache->dir = dir;
+    cache->hash_cons = hash_cons;
+    cache->parsed_hits = 0;
+    cache->optimized_hits = 0;
+    cache->misses = 0;
+    cache->stores = 0;
+    cache->store_failures = 0;
+    pthread_mutex_init(&cache->lock, NULL);
+    return 1;
+}
+
+
+void parse_cache_free(ParseCache* cache) {
+    pthread_mutex_destroy(&cache->lock);
+}
+
+
+/* dir/<hash>-<size>.ast, or .opt<OPTIMIZE_VERSION>.ast for optimized
+   trees (.opt<OPTIMIZE_VERSION>hc.ast with hash-consing); `extra` bytes are left free at the end for a temporary-file
+   suffix. */
+static char* entry_path(const ParseCache* cache, const CacheKey* key, CacheStage stage, size_t extra) {
+    size_t len = strlen(cache->dir) + 48 + extra;
+    char* path = (char*)malloc(len);
+    if (!path) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    if (stage == CACHE_OPTIMIZED) {
+        snprintf(path, len, "%s/%016llx-%llx.opt%d%s.ast", cache->dir,
+                 (unsigned long long)key->hash, (unsigned long long)key->size,
+                 OPTIMIZE_VERSION, cache->hash_cons ? "hc" : "");
+    } else {
+        snprintf(path, len, "%s/%016llx-%llx.ast", cache->dir,
+                 (unsigned long long)key->hash, (unsigned long long)key->size);
+    }
+    return path;
+}
+
+
+ASTNode* parse_cache_lookup(ParseCache* cache, const CacheKey* key, CacheStage* stage) {
+    static const CacheStage order[] = { CACHE_OPTIMIZED, CACHE_PARSED };
+    ASTNode* root = NULL;
+
+    *stage = CACHE_MISS;
+    for (size_t i = 0; i < sizeof(order) / sizeof(order[0]) && !root; i++) {
+        char* path = entry_path(cache, key, order[i], 0);
+        root = ast_bin_load(path);
+        free(path);
+        if (root) *stage = order[i];
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    if (*stage == CACHE_OPTIMIZED) {
+        cache->optimized_hits++;
+    } else if (*stage == CACHE_PARSED) {
+        cache->parsed_hits++;
+    } else {
+        cache->misses++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return root;
+}
+
+
+static int write_entry(char* path, ASTNode* root) {
+    int fd = mkstemp(path);
+    if (fd < 0) return 0;
+
+    FILE* file = fdopen(fd, "wb");
+    if (!file) {
+        close(fd);
+        unlink(path);
+        return 0;
+    }
+
+    OutBuf out;
+    outbuf_init(&out, file);
+    ast_bin_write(root, &out);
+    outbuf_close(&out);
+
+    int ok = !ferror(file);
+    if (fclose(file) != 0) ok = 0;
+    if (!ok) unlink(path);
+    return ok;
+}
+
+
+void parse_cache_store(ParseCache* cache, const CacheKey* key, CacheStage stage, ASTNode* root) {
+    char* path = entry_path(cache, key, stage, 0);
+    char* temp = entry_path(cache, key, stage, 8);
+    strcat(temp, ".XXXXXX");
+
+    int ok = write_entry(temp, root);
+    if (ok && rename(temp, path) != 0) {
+        unlink(temp);
+        ok = 0;
+    }
+    free(path);
+    free(temp);
+
+    pthread_mutex_lock(&cache->lock);
+    if (ok) {
+        cache->stores++;
+    } else {
+        cache->store_failures++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+
+void parse_cache_report(const ParseCache* cache, FILE* output) {
+    fprintf(output, "Cache: %zu hits (%zu optimized, %zu parsed), %zu misses, %zu stored",
+            cache->parsed_hits + cache->optimized_hits, cache->optimized_hits,
+            cache->parsed_hits, cache->misses, cache->stores);
+    if (cache->store_failures) {
+        fprintf(output, ", %zu failed to store", cache->store_failures);
+    }
+    fputc('\n', output);
+}
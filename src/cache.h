@@ -0,0 +1,59 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "ast.h"
+
+
+/* Identifies a source file by its contents: equal keys mean the cached
+   trees can stand in for parsing it. */
+typedef struct {
+    uint64_t hash;
+    uint64_t size;
+} CacheKey;
+
+
+typedef enum {
+    CACHE_MISS,
+    CACHE_PARSED,         /* tree as the parser built it */
+    CACHE_OPTIMIZED       /* tree after the optimization passes */
+} CacheStage;
+
+
+/* On-disk cache of serialized trees (see ast_bin.h), one file per key
+   and stage in `dir`. Entries are written to a temporary file and
+   renamed into place, so workers and concurrent runs can share a
+   directory. Shared by all workers of a batch. */
+typedef struct {
+    const char* dir;
+    int hash_cons;          /* optimized trees differ with hash-consing */
+    size_t parsed_hits;
+    size_t optimized_hits;
+    size_t misses;
+    size_t stores;
+    size_t store_failures;
+    pthread_mutex_t lock;   /* guards the counters */
+} ParseCache;
+
+
+/* Creates `dir` if needed; returns 0 and sets errno on failure. Optimized
+   trees are kept apart for runs with and without hash-consing. */
+int parse_cache_init(ParseCache* cache, const char* dir, int hash_cons);
+
+void parse_cache_free(ParseCache* cache);
+
+CacheKey cache_key(const char* data, size_t size);
+
+/* Loads the most processed tree stored for `key` into the calling
+   thread's AST arena and sets *stage to its stage, or returns NULL with
+   *stage set to CACHE_MISS. */
+ASTNode* parse_cache_lookup(ParseCache* cache, const CacheKey* key, CacheStage* stage);
+
+/* Best effort: a failed write is only counted. */
+void parse_cache_store(ParseCache* cache, const CacheKey* key, CacheStage stage, ASTNode* root);
+
+void parse_cache_report(const ParseCache* cache, FILE* output);
+
+#endif
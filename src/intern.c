@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+
+
+#define INTERN_INITIAL_CAPACITY 256
+
+
+static unsigned hash_bytes(const char* str, size_t len) {
+    unsigned hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+static void intern_grow(InternTable* table) {
+    size_t capacity = table->capacity ? table->capacity * 2 : INTERN_INITIAL_CAPACITY;
+    const char** slots = (const char**)calloc(capacity, sizeof(const char*));
+    unsigned* hashes = (unsigned*)malloc(capacity * sizeof(unsigned));
+    if (!slots || !hashes) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (!table->slots[i]) continue;
+
+        size_t j = table->hashes[i] & (capacity - 1);
+        while (slots[j]) {
+            j = (j + 1) & (capacity - 1);
+        }
+        slots[j] = table->slots[i];
+        hashes[j] = table->hashes[i];
+    }
+
+    free(table->slots);
+    free(table->hashes);
+    table->slots = slots;
+    table->hashes = hashes;
+    table->capacity = capacity;
+}
+
+
+void intern_init(InternTable* table, Arena* arena) {
+    table->arena = arena;
+    table->slots = NULL;
+    table->hashes = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+
+const char* intern_str(InternTable* table, const char* str, size_t len) {
+    if (table->count * 2 >= table->capacity) {
+        intern_grow(table);
+    }
+
+    unsigned hash = hash_bytes(str, len);
+    size_t mask = table->capacity - 1;
+    size_t i = hash & mask;
+
+    while (table->slots[i]) {
+        const char* sym = table->slots[i];
+        if (table->hashes[i] == hash && strncmp(sym, str, len) == 0 && sym[len] == '\0') {
+            return sym;
+        }
+        i = (i + 1) & mask;
+    }
+
+    const char* sym = arena_strndup(table->arena, str, len);
+    table->slots[i] = sym;
+    table->hashes[i] = hash;
+    table->count++;
+
+    return sym;
+}
+
+
+void intern_reset(InternTable* table) {
+    free(table->slots);
+    free(table->hashes);
+    intern_init(table, table->arena);
+}
+
+
+void intern_clear(InternTable* table) {
+    if (table->slots) {
+        memset(table->slots, 0, table->capacity * sizeof(const char*));
+    }
+    table->count = 0;
+}
@@ -0,0 +1,29 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include "arena.h"
+
+
+/* Open-addressing table of unique strings; the strings live in `arena`. */
+typedef struct {
+    Arena* arena;
+    const char** slots;
+    unsigned* hashes;
+    size_t capacity;
+    size_t count;
+} InternTable;
+
+
+void intern_init(InternTable* table, Arena* arena);
+
+/* Returns the unique copy of str[0..len); equal strings give equal pointers. */
+const char* intern_str(InternTable* table, const char* str, size_t len);
+
+/* Drops the index; the strings themselves go with the arena. */
+void intern_reset(InternTable* table);
+
+/* Like intern_reset, but keeps the index allocated for the next parse. */
+void intern_clear(InternTable* table);
+
+#endif
@@ -1,33 +1,811 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "ast.h"
+#include "ast_bin.h"
+#include "cache.h"
+#include "optimize.h"
+#include "parse.h"
+#include "source.h"
+#include "stats.h"
+#include "visual.h"
 
-extern int yyparse();
-extern FILE* yyin;              
-extern ASTNode* ast_root;
 
-int main() {
-  
-    yyin = fopen("input.c", "r");   
-    if (!yyin) {
-        perror("input.c");
-        return 1;
+typedef struct {
+    const char* out_dir;     /* NULL: write next to each input */
+    int jobs;                /* worker threads; 0 = one per core */
+    size_t func_jobs;        /* threads per file for its functions */
+    int write_dot;
+    int emit_ast;            /* save each parsed tree for later runs */
+    int use_stdio;           /* read through a FILE instead of mapping the input */
+    LexerKind lexer;         /* scanner for mapped inputs */
+    int check_lexer;         /* compare both scanners on each mapped input */
+    ParseCache* cache;       /* NULL: always parse */
+    RunStats* stats;         /* NULL: no --stats */
+    int quiet;
+    int collapse;
+    int hash_cons;           /* share identical expression nodes */
+    DotOptions dot;
+} Options;
+
+
+typedef struct {
+    char** paths;          /* owned copies */
+    size_t count;
+    size_t capacity;
+} PathList;
+
+
+#define PASS_COUNT 3
+
+
+/* In pipeline order; pass p is timed as phase PHASE_FOLD + p. */
+static void (*const passes[PASS_COUNT])(ASTNode* root, PassStats* stats) = {
+    fold_constants,
+    eliminate_dead_code,
+    eliminate_common_subexpressions
+};
+
+
+/* The top-level functions of one file, handed out to threads one at a
+   time like the files of a Batch. The chain is cut first, so a thread
+   only ever walks the function it got. Nodes a helper thread creates
+   live in its own arena, so helpers keep theirs until the file's tree
+   has been written out and `released` is set. */
+typedef struct {
+    ASTNode** units;
+    char** text;             /* printed form of each unit; NULL: print the tree at the end */
+    size_t* length;
+    size_t count;
+    size_t next;
+    int optimize;
+    int hash_cons;
+    PassStats totals[PASS_COUNT];
+    PhaseStats phases[PHASE_COUNT];   /* the passes and printing, summed over threads */
+    AstAllocStats alloc;     /* summed over helper threads */
+    pthread_t* helpers;
+    size_t helper_count;
+    size_t done;             /* helpers through with their units */
+    int released;
+    pthread_mutex_t lock;    /* guards everything from `next` on */
+    pthread_cond_t cond;
+} UnitBatch;
+
+
+/* Files are handed out one at a time, so a slow file only holds up the
+   worker that got it. */
+typedef struct {
+    const PathList* inputs;
+    const Options* opts;
+    size_t next;
+    size_t failures;
+    pthread_mutex_t lock;    /* guards next and failures */
+} Batch;
+
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [options] [file.c ...]\n"
+            "  -o DIR             write outputs into DIR, creating it if needed\n"
+            "  -l FILE            read input paths from FILE, one per line (- for stdin)\n"
+            "  -q                 one summary line instead of per-file reports\n"
+            "  -j N, -jN          use N threads, split over files and then over the\n"
+            "                     functions of each file (default: one per core)\n"
+            "  --no-dot           do not write DOT files\n"
+            "  --emit-ast         also save each parsed tree as name.ast\n"
+            "  --stdio            read inputs with stdio instead of mmap (no caching)\n"
+            "  --cache DIR        reuse parsed and optimized trees of unchanged inputs\n"
+            "  --hash-cons        share one node between identical expressions\n"
+            "  --stats[=json]     print time, tokens, nodes and bytes per phase at the end\n"
+            "  --lexer NAME       scan mapped inputs with flex (default) or simd\n"
+            "  --check-lexer      fail inputs on which the two scanners disagree\n"
+            "  --dot-depth N      collapse DOT subtrees below depth N\n"
+            "  --dot-size N       collapse DOT subtrees larger than N nodes\n"
+            "  --dot-focus NAME   only expand the path to function NAME\n"
+            "  --dot-budget N     emit at most N DOT nodes\n"
+            "With no inputs, reads input.c and writes output.txt and ast.dot.\n"
+            "Otherwise each dir/name.c gives name.txt and name.dot; inputs that\n"
+            "would write the same files are rejected.\n"
+            "Inputs named *.ast are loaded instead of parsed.\n",
+            prog);
+}
+
+
+static void add_path(PathList* list, const char* path) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 64;
+        list->paths = (char**)realloc(list->paths, list->capacity * sizeof(char*));
+        if (!list->paths) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+    }
+
+    char* copy = strdup(path);
+    if (!copy) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    list->paths[list->count++] = copy;
+}
+
+
+static int read_path_list(PathList* list, const char* name) {
+    FILE* file = strcmp(name, "-") == 0 ? stdin : fopen(name, "r");
+    if (!file) {
+        perror(name);
+        return 0;
+    }
+
+    char line[4096];
+    while (fgets(line, sizeof(line), file)) {
+        size_t len = strcspn(line, "\r\n");
+        if (len == 0) continue;
+        line[len] = '\0';
+        add_path(list, line);
+    }
+
+    if (file != stdin) fclose(file);
+    return 1;
+}
+
+
+/* dir/name.c -> <out_dir or dir>/name<ext> */
+static char* output_path(const char* input, const char* out_dir, const char* ext) {
+    const char* base = strrchr(input, '/');
+    base = base ? base + 1 : input;
+    const char* dot = strrchr(base, '.');
+    size_t stem = dot && dot != base ? (size_t)(dot - base) : strlen(base);
+
+    const char* dir = out_dir ? out_dir : input;
+    size_t dir_len = out_dir ? strlen(out_dir) : (size_t)(base - input);
+    int slash = out_dir && dir_len && out_dir[dir_len - 1] != '/';
+
+    char* path = (char*)malloc(dir_len + slash + stem + strlen(ext) + 1);
+    if (!path) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    memcpy(path, dir, dir_len);
+    if (slash) path[dir_len] = '/';
+    memcpy(path + dir_len + slash, base, stem);
+    strcpy(path + dir_len + slash + stem, ext);
+    return path;
+}
+
+
+typedef struct {
+    char* output;
+    const char* input;
+} OutputName;
+
+
+static int compare_output_names(const void* a, const void* b) {
+    return strcmp(((const OutputName*)a)->output, ((const OutputName*)b)->output);
+}
+
+
+/* Inputs are named by their stem alone, so dir1/a.c and dir2/a.c would
+   write the same files (and race when on different workers). Returns 0
+   after reporting the first such pair. */
+static int check_output_names(const PathList* inputs, const char* out_dir) {
+    OutputName* names = (OutputName*)malloc(inputs->count * sizeof(OutputName));
+    if (!names) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < inputs->count; i++) {
+        names[i].output = output_path(inputs->paths[i], out_dir, "");
+        names[i].input = inputs->paths[i];
+    }
+    qsort(names, inputs->count, sizeof(OutputName), compare_output_names);
+
+    int ok = 1;
+    for (size_t i = 1; i < inputs->count && ok; i++) {
+        if (strcmp(names[i - 1].output, names[i].output) == 0) {
+            fprintf(stderr, "%s and %s would both write %s.txt\n",
+                    names[i - 1].input, names[i].input, names[i].output);
+            ok = 0;
+        }
+    }
+
+    for (size_t i = 0; i < inputs->count; i++) {
+        free(names[i].output);
+    }
+    free(names);
+    return ok;
+}
+
+
+static int is_ast_path(const char* path) {
+    size_t len = strlen(path);
+    return len > 4 && strcmp(path + len - 4, ".ast") == 0;
+}
+
+
+static void add_pass_stats(PassStats* total, const PassStats* part) {
+    total->name = part->name;
+    total->nodes_folded += part->nodes_folded;
+    total->nodes_freed += part->nodes_freed;
+    total->evals_removed += part->evals_removed;
+    total->elapsed_ms += part->elapsed_ms;
+}
+
+
+static void add_alloc_stats(AstAllocStats* total, const AstAllocStats* part) {
+    total->nodes += part->nodes;
+    total->live += part->live;
+    total->bytes += part->bytes;
+    total->reserved += part->reserved;
+    total->shared += part->shared;
+    for (int i = 0; i < NODE_TYPE_COUNT; i++) {
+        total->created[i] += part->created[i];
+    }
+}
+
+
+/* Optimizes and, when the batch collects text, prints units until none
+   are left. */
+static void run_units(UnitBatch* ub) {
+    PassStats totals[PASS_COUNT];
+    PhaseStats phases[PHASE_COUNT];
+    PhaseMark mark;
+    OutBuf buf;
+
+    memset(totals, 0, sizeof(totals));
+    memset(phases, 0, sizeof(phases));
+    if (ub->text) outbuf_init(&buf, NULL);
+
+    for (;;) {
+        pthread_mutex_lock(&ub->lock);
+        size_t i = ub->next++;
+        pthread_mutex_unlock(&ub->lock);
+        if (i >= ub->count) break;
+
+        ASTNode* unit = ub->units[i];
+        for (int p = 0; p < PASS_COUNT && ub->optimize; p++) {
+            PassStats stats;
+            phase_mark(&mark);
+            passes[p](unit, &stats);
+            phase_add(&phases[PHASE_FOLD + p], &mark, 0);
+            add_pass_stats(&totals[p], &stats);
+        }
+
+        /* The bytes are counted when the texts reach the output file. */
+        if (ub->text) {
+            phase_mark(&mark);
+            buf.file = open_memstream(&ub->text[i], &ub->length[i]);
+            if (!buf.file) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(1);
+            }
+            write_ast(unit, &buf, 0);
+            outbuf_flush(&buf);
+            fclose(buf.file);
+            phase_add(&phases[PHASE_PRINT], &mark, 0);
+        }
+    }
+    if (ub->text) outbuf_close(&buf);
+
+    pthread_mutex_lock(&ub->lock);
+    for (int p = 0; p < PASS_COUNT; p++) {
+        add_pass_stats(&ub->totals[p], &totals[p]);
+    }
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        phase_stats_merge(&ub->phases[p], &phases[p]);
+    }
+    pthread_mutex_unlock(&ub->lock);
+}
+
+
+static void* unit_helper(void* arg) {
+    UnitBatch* ub = (UnitBatch*)arg;
+    AstAllocStats alloc;
+
+    ast_set_hash_consing(ub->hash_cons);
+    run_units(ub);
+    ast_alloc_stats(&alloc);
+
+    pthread_mutex_lock(&ub->lock);
+    add_alloc_stats(&ub->alloc, &alloc);
+    ub->done++;
+    pthread_cond_broadcast(&ub->cond);
+    while (!ub->released) {
+        pthread_cond_wait(&ub->cond, &ub->lock);
+    }
+    pthread_mutex_unlock(&ub->lock);
+
+    free_ast(NULL);
+    return NULL;
+}
+
+
+/* Cuts the chain at `root` into units and runs them on up to `jobs`
+   threads, the calling one included. With more than one thread each unit
+   is also printed as it is finished. */
+static void run_unit_batch(UnitBatch* ub, ASTNode* root, int optimize, const Options* opts) {
+    memset(ub, 0, sizeof(*ub));
+    ub->optimize = optimize;
+    ub->hash_cons = opts->hash_cons;
+    pthread_mutex_init(&ub->lock, NULL);
+    pthread_cond_init(&ub->cond, NULL);
+
+    for (ASTNode* unit = root; unit; unit = unit->next) {
+        ub->count++;
     }
+    ub->units = (ASTNode**)malloc(ub->count * sizeof(ASTNode*));
+    if (!ub->units) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < ub->count; i++) {
+        ub->units[i] = root;
+        root = root->next;
+        ub->units[i]->next = NULL;
+    }
+
+    size_t jobs = opts->func_jobs < ub->count ? opts->func_jobs : ub->count;
+    if (jobs > 1) {
+        ub->text = (char**)calloc(ub->count, sizeof(char*));
+        ub->length = (size_t*)calloc(ub->count, sizeof(size_t));
+        ub->helpers = (pthread_t*)malloc((jobs - 1) * sizeof(pthread_t));
+        if (!ub->text || !ub->length || !ub->helpers) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        while (ub->helper_count + 1 < jobs &&
+               pthread_create(&ub->helpers[ub->helper_count], NULL, unit_helper, ub) == 0) {
+            ub->helper_count++;
+        }
+    }
+
+    run_units(ub);
+
+    pthread_mutex_lock(&ub->lock);
+    while (ub->done < ub->helper_count) {
+        pthread_cond_wait(&ub->cond, &ub->lock);
+    }
+    pthread_mutex_unlock(&ub->lock);
+
+    for (size_t i = 0; i + 1 < ub->count; i++) {
+        ub->units[i]->next = ub->units[i + 1];
+    }
+}
 
-   
-    FILE* out = fopen("output.txt", "w");
+
+/* Lets the helpers drop their arenas; the tree must not be used after. */
+static void finish_unit_batch(UnitBatch* ub) {
+    pthread_mutex_lock(&ub->lock);
+    ub->released = 1;
+    pthread_cond_broadcast(&ub->cond);
+    pthread_mutex_unlock(&ub->lock);
+    for (size_t i = 0; i < ub->helper_count; i++) {
+        pthread_join(ub->helpers[i], NULL);
+    }
+
+    if (ub->text) {
+        for (size_t i = 0; i < ub->count; i++) {
+            free(ub->text[i]);
+        }
+    }
+    free(ub->text);
+    free(ub->length);
+    free(ub->helpers);
+    free(ub->units);
+    pthread_cond_destroy(&ub->cond);
+    pthread_mutex_destroy(&ub->lock);
+}
+
+
+/* Parses, optimizes and prints one file; the parser and this thread's AST
+   arena are reset rather than rebuilt between files. */
+static int process_file(Parser* parser, const char* input, const char* output,
+                        const char* dot_path, const char* ast_path, const Options* opts) {
+    ASTNode* ast_root = NULL;
+    LineIndex lines = { NULL, 0 };
+    int loaded = is_ast_path(input);
+    CacheStage cached = CACHE_MISS;
+    CacheKey key;
+    FileStats stats;
+    PhaseMark mark;
+
+    memset(&stats, 0, sizeof(stats));
+    stats.files = 1;
+    ast_set_hash_consing(opts->hash_cons);
+
+    phase_mark(&mark);
+    if (loaded) {
+        ast_root = ast_bin_load(input);
+        phase_add(&stats.phases[PHASE_READ], &mark, 0);
+        if (!ast_root) {
+            if (errno) {
+                perror(input);
+            } else {
+                fprintf(stderr, "%s: not a serialized AST\n", input);
+            }
+            reset_ast();
+            return 0;
+        }
+    } else if (opts->use_stdio) {
+        FILE* in = fopen(input, "r");
+        if (!in) {
+            perror(input);
+            return 0;
+        }
+        phase_add(&stats.phases[PHASE_READ], &mark, 0);
+        phase_mark(&mark);
+        ast_root = parser_parse(parser, in, input);
+        phase_add(&stats.phases[PHASE_PARSE], &mark, 0);
+        stats.bytes_read = (size_t)ftell(in);
+        fclose(in);
+    } else {
+        SourceBuffer src;
+        if (!source_open(&src, input)) {
+            perror(input);
+            return 0;
+        }
+        /* Symbols are interned as they are scanned and nodes only keep
+           offsets, so the tree does not point into the mapping and it can
+           go as soon as the DOT tooltips have their line index. */
+        stats.bytes_read = src.size;
+        if (opts->check_lexer) {
+            int agree = parser_check_lexers(parser, src.data, src.size, input);
+            reset_ast();
+            if (!agree) {
+                source_close(&src);
+                return 0;
+            }
+        }
+        parser->lexer = opts->lexer;
+        if (opts->cache) {
+            key = cache_key(src.data, src.size);
+            ast_root = parse_cache_lookup(opts->cache, &key, &cached);
+        }
+        phase_add(&stats.phases[PHASE_READ], &mark, 0);
+        if (cached == CACHE_MISS && opts->stats) {
+            /* The whole input is tokenized first so scanning and parsing
+               are timed apart. */
+            TokenBuffer tokens;
+            token_buffer_init(&tokens);
+            phase_mark(&mark);
+            stats.tokens = parser_tokenize(parser, src.data, src.size, input, &tokens);
+            phase_add(&stats.phases[PHASE_SCAN], &mark, 0);
+            phase_mark(&mark);
+            ast_root = parser_parse_tokens(parser, &tokens, src.data, input);
+            phase_add(&stats.phases[PHASE_PARSE], &mark, 0);
+            token_buffer_free(&tokens);
+        } else if (cached == CACHE_MISS) {
+            phase_mark(&mark);
+            ast_root = parser_parse_buffer(parser, src.data, src.size, input);
+            phase_add(&stats.phases[PHASE_PARSE], &mark, 0);
+        }
+        if (cached == CACHE_MISS) {
+            if (ast_root && opts->cache) {
+                parse_cache_store(opts->cache, &key, CACHE_PARSED, ast_root);
+            }
+        }
+        if (ast_root && opts->write_dot) {
+            line_index_build(&lines, src.data, src.size);
+        }
+        source_close(&src);
+    }
+
+    if (!ast_root) {
+        fprintf(stderr, "%s: parse failed\n", input);
+        reset_ast();
+        return 0;
+    }
+
+    /* Saved before the passes run, so a load replays them from the parse. */
+    int saved = opts->emit_ast && !loaded;
+    if (saved && !ast_bin_save(ast_root, ast_path)) {
+        perror(ast_path);
+        line_index_free(&lines);
+        reset_ast();
+        return 0;
+    }
+
+    FILE* out = fopen(output, "w");
     if (!out) {
-        perror("output.txt");
-        return 1;
+        perror(output);
+        line_index_free(&lines);
+        reset_ast();
+        return 0;
     }
 
-    yyparse();
+    /* Each function is optimized on its own, whichever thread runs it,
+       so the output does not depend on the thread count. */
+    UnitBatch units;
+    run_unit_batch(&units, ast_root, cached != CACHE_OPTIMIZED, opts);
+    if (cached != CACHE_OPTIMIZED && opts->cache) {
+        parse_cache_store(opts->cache, &key, CACHE_OPTIMIZED, ast_root);
+    }
 
-    fprintf(out, "AST:\n");
-    print_ast(ast_root, out, 0);
+    OutBuf buf;
+    outbuf_init(&buf, out);
 
-    fclose(yyin);
+    phase_mark(&mark);
+    outbuf_puts(&buf, "AST:\n");
+    if (units.text) {
+        for (size_t i = 0; i < units.count; i++) {
+            outbuf_write(&buf, units.text[i], units.length[i]);
+        }
+    } else {
+        write_ast(ast_root, &buf, 0);
+    }
+    outbuf_flush(&buf);
+    size_t printed = buf.bytes_written;
+    phase_add(&units.phases[PHASE_PRINT], &mark, printed);
+    double print_ms = units.phases[PHASE_PRINT].ms;
+    outbuf_close(&buf);
     fclose(out);
 
-    printf("AST saved to output.txt\n");
-    return 0;
+    size_t dot_nodes = 0;
+    double dot_ms = 0;
+    if (opts->write_dot) {
+        FILE* dot = fopen(dot_path, "w");
+        if (!dot) {
+            perror(dot_path);
+            line_index_free(&lines);
+            finish_unit_batch(&units);
+            reset_ast();
+            return 0;
+        }
+        outbuf_init(&buf, dot);
+        phase_mark(&mark);
+        const LineIndex* index = lines.starts ? &lines : NULL;  /* none with --stdio */
+        dot_nodes = opts->collapse ? write_dot_collapsed(ast_root, &buf, &opts->dot, index)
+                                   : write_dot(ast_root, &buf, index);
+        outbuf_flush(&buf);
+        phase_add(&stats.phases[PHASE_DOT], &mark, buf.bytes_written);
+        dot_ms = stats.phases[PHASE_DOT].ms;
+        outbuf_close(&buf);
+        fclose(dot);
+    }
+    line_index_free(&lines);
+
+    AstAllocStats alloc;
+    ast_alloc_stats(&alloc);
+    add_alloc_stats(&alloc, &units.alloc);
+    size_t unit_count = units.count;
+    size_t unit_threads = units.helper_count + 1;
+    PassStats totals[PASS_COUNT];
+    memcpy(totals, units.totals, sizeof(totals));
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        phase_stats_merge(&stats.phases[p], &units.phases[p]);
+    }
+    finish_unit_batch(&units);
+    reset_ast();
+
+    if (opts->stats) run_stats_merge(opts->stats, &stats);
+
+    if (opts->quiet) return 1;
+
+    /* One report at a time when several workers share stdout. */
+    flockfile(stdout);
+    printf("AST saved to %s\n", output);
+    if (saved) {
+        printf("Parsed tree saved to %s\n", ast_path);
+    }
+    if (opts->write_dot) {
+        printf("DOT file '%s' generated (%zu nodes in %.3f ms).\n", dot_path, dot_nodes, dot_ms);
+        printf("Run: dot -Tpng %s -o ast.png\n", dot_path);
+    }
+    if (unit_count > 1) {
+        printf("Functions: %zu on %zu threads\n", unit_count, unit_threads);
+    }
+    printf("Arena: %zu nodes (%zu live), %zu bytes allocated (%zu reserved)\n",
+           alloc.nodes, alloc.live, alloc.bytes, alloc.reserved);
+    if (opts->hash_cons) {
+        printf("Hash-consing: %zu constructor calls reused a shared node\n", alloc.shared);
+    }
+    if (cached == CACHE_OPTIMIZED) {
+        printf("Optimized tree loaded from cache\n");
+    } else {
+        if (cached == CACHE_PARSED) printf("Parsed tree loaded from cache\n");
+        for (int p = 0; p < PASS_COUNT; p++) {
+            print_pass_stats(&totals[p], stdout);
+        }
+    }
+    printf("print_ast: %zu bytes in %.3f ms (%.1f MB/s)\n", printed, print_ms,
+           print_ms > 0 ? printed / (print_ms * 1000.0) : 0.0);
+    funlockfile(stdout);
+    return 1;
+}
+
+
+static void* batch_worker(void* arg) {
+    Batch* batch = (Batch*)arg;
+    Parser parser;
+    size_t failures = 0;
+
+    parser_init(&parser);
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        size_t i = batch->next++;
+        pthread_mutex_unlock(&batch->lock);
+        if (i >= batch->inputs->count) break;
+
+        const char* input = batch->inputs->paths[i];
+        char* output = output_path(input, batch->opts->out_dir, ".txt");
+        char* dot_path = output_path(input, batch->opts->out_dir, ".dot");
+        char* ast_path = output_path(input, batch->opts->out_dir, ".ast");
+
+        if (!process_file(&parser, input, output, dot_path, ast_path, batch->opts)) failures++;
+
+        free(output);
+        free(dot_path);
+        free(ast_path);
+    }
+    parser_free(&parser);
+    free_ast(NULL);
+
+    pthread_mutex_lock(&batch->lock);
+    batch->failures += failures;
+    pthread_mutex_unlock(&batch->lock);
+    return NULL;
+}
+
+
+/* Runs the batch on `jobs` threads, the calling thread included. */
+static size_t run_batch(const PathList* inputs, const Options* opts, size_t jobs) {
+    Batch batch = { .inputs = inputs, .opts = opts };
+    pthread_t* threads = (pthread_t*)malloc(jobs * sizeof(pthread_t));
+    if (!threads) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    pthread_mutex_init(&batch.lock, NULL);
+    size_t started = 0;
+    while (started + 1 < jobs && pthread_create(&threads[started], NULL, batch_worker, &batch) == 0) {
+        started++;
+    }
+    batch_worker(&batch);
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&batch.lock);
+
+    free(threads);
+    return batch.failures;
+}
+
+
+int main(int argc, char** argv) {
+    Options opts = { NULL, 0, 1, 1, 0, 0, LEXER_FLEX, 0, NULL, NULL, 0, 0, 0, { 0, 0, NULL, 0 } };
+    ParseCache cache;
+    RunStats stats;
+    int stats_json = 0;
+    const char* cache_dir = NULL;
+    PathList inputs = { NULL, 0, 0 };
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+
+        if (arg[0] != '-') {
+            add_path(&inputs, arg);
+        } else if (strcmp(arg, "-q") == 0) {
+            opts.quiet = 1;
+        } else if (strcmp(arg, "--no-dot") == 0) {
+            opts.write_dot = 0;
+        } else if (strcmp(arg, "--emit-ast") == 0) {
+            opts.emit_ast = 1;
+        } else if (strcmp(arg, "--hash-cons") == 0) {
+            opts.hash_cons = 1;
+        } else if (strcmp(arg, "--stats") == 0) {
+            opts.stats = &stats;
+        } else if (strcmp(arg, "--stats=json") == 0) {
+            opts.stats = &stats;
+            stats_json = 1;
+        } else if (strcmp(arg, "--stdio") == 0) {
+            opts.use_stdio = 1;
+        } else if (strcmp(arg, "--check-lexer") == 0) {
+            opts.check_lexer = 1;
+        } else if (strncmp(arg, "-j", 2) == 0 && arg[2]) {
+            opts.jobs = atoi(arg + 2);
+        } else if (i + 1 == argc) {
+            usage(argv[0]);
+            return 1;
+        } else if (strcmp(arg, "-j") == 0) {
+            opts.jobs = atoi(argv[++i]);
+        } else if (strcmp(arg, "--lexer") == 0) {
+            const char* name = argv[++i];
+            if (strcmp(name, "flex") == 0) {
+                opts.lexer = LEXER_FLEX;
+            } else if (strcmp(name, "simd") == 0) {
+                opts.lexer = LEXER_SIMD;
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(arg, "--cache") == 0) {
+            cache_dir = argv[++i];
+        } else if (strcmp(arg, "-o") == 0) {
+            opts.out_dir = argv[++i];
+        } else if (strcmp(arg, "-l") == 0) {
+            if (!read_path_list(&inputs, argv[++i])) return 1;
+        } else if (strcmp(arg, "--dot-depth") == 0) {
+            opts.dot.max_depth = atoi(argv[++i]);
+            opts.collapse = 1;
+        } else if (strcmp(arg, "--dot-size") == 0) {
+            opts.dot.max_size = strtoul(argv[++i], NULL, 10);
+            opts.collapse = 1;
+        } else if (strcmp(arg, "--dot-focus") == 0) {
+            opts.dot.focus = argv[++i];
+            opts.collapse = 1;
+        } else if (strcmp(arg, "--dot-budget") == 0) {
+            opts.dot.budget = strtoul(argv[++i], NULL, 10);
+            opts.collapse = 1;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!check_output_names(&inputs, opts.out_dir)) return 1;
+    if (opts.out_dir && mkdir(opts.out_dir, 0777) != 0 && errno != EEXIST) {
+        perror(opts.out_dir);
+        return 1;
+    }
+
+    if (cache_dir) {
+        if (!parse_cache_init(&cache, cache_dir, opts.hash_cons)) {
+            perror(cache_dir);
+            return 1;
+        }
+        opts.cache = &cache;
+    }
+
+    if (opts.stats) run_stats_init(&stats);
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t jobs = opts.jobs > 0 ? (size_t)opts.jobs : cores > 0 ? (size_t)cores : 1;
+    double start = pass_time_ms();
+
+    int ok;
+    if (inputs.count == 0) {
+        opts.func_jobs = jobs;
+
+        Parser parser;
+        parser_init(&parser);
+        ok = process_file(&parser, "input.c", "output.txt", "ast.dot", "input.ast", &opts);
+        parser_free(&parser);
+        free_ast(NULL);
+    } else {
+        /* Threads left over when there are fewer files go to the
+           functions inside them. */
+        size_t total = jobs;
+        if (jobs > inputs.count) jobs = inputs.count;
+        opts.func_jobs = total / jobs;
+
+        size_t failures = run_batch(&inputs, &opts, jobs);
+        ok = failures == 0;
+
+        /* The JSON carries the same numbers and should be all that is
+           printed with -q. */
+        if ((inputs.count > 1 || opts.quiet) && !stats_json) {
+            printf("Processed %zu files (%zu failed) on %zu threads in %.3f ms\n",
+                   inputs.count, failures, jobs, pass_time_ms() - start);
+        }
+    }
+
+    if (opts.cache) {
+        parse_cache_report(&cache, stdout);
+        parse_cache_free(&cache);
+    }
+    if (opts.stats) {
+        stats.wall_ms = pass_time_ms() - start;
+        run_stats_print(&stats, stdout, stats_json);
+        run_stats_free(&stats);
+    }
+    for (size_t i = 0; i < inputs.count; i++) {
+        free(inputs.paths[i]);
+    }
+    free(inputs.paths);
+    return ok ? 0 : 1;
 }
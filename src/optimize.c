@@ -0,0 +1,1016 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include "optimize.h"
+#include "walk.h"
+#include "symmap.h"
+
+
+/* A declared variable; `shadowed` links to the outer binding of the same name. */
+typedef struct {
+    const char* name;
+    int value;
+    int known;
+    int loop_depth;
+    int shadowed;
+} Binding;
+
+
+typedef struct {
+    Binding* bindings;
+    size_t count;
+    size_t capacity;
+    SymMap scopes;          /* name -> index of its innermost binding */
+    int loop_depth;
+    PassStats* stats;
+    AstWalker shared;       /* for fold_shared */
+    ASTNode** values;       /* fold_shared's results, children first */
+    size_t value_count;
+    size_t value_capacity;
+} FoldState;
+
+
+double pass_time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+
+static void* xrealloc(void* ptr, size_t size) {
+    void* result = realloc(ptr, size);
+    if (!result) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    return result;
+}
+
+
+static Binding* lookup(FoldState* st, const char* name) {
+    SymSlot* slot = symmap_find(&st->scopes, name);
+    if (!slot || slot->value < 0) return NULL;
+    return &st->bindings[slot->value];
+}
+
+
+static void bind(FoldState* st, const char* name, int known, int value) {
+    if (st->count == st->capacity) {
+        st->capacity = st->capacity ? st->capacity * 2 : 64;
+        st->bindings = (Binding*)xrealloc(st->bindings, st->capacity * sizeof(Binding));
+    }
+
+    SymSlot* slot = symmap_insert(&st->scopes, name, -1);
+
+    Binding* b = &st->bindings[st->count];
+    b->name = name;
+    b->value = value;
+    b->known = known;
+    b->loop_depth = st->loop_depth;
+    b->shadowed = slot->value;
+    slot->value = (int)st->count++;
+}
+
+
+static void pop_scope(FoldState* st, size_t mark) {
+    while (st->count > mark) {
+        Binding* b = &st->bindings[--st->count];
+        symmap_find(&st->scopes, b->name)->value = b->shadowed;
+    }
+}
+
+
+static void kill(FoldState* st, const char* name) {
+    Binding* b = lookup(st, name);
+    if (b) b->known = 0;
+}
+
+
+int eval_binop(OpKind op, int a, int b, int* result) {
+    unsigned ua = (unsigned)a, ub = (unsigned)b;
+
+    switch (op) {
+        case OP_ADD: *result = (int)(ua + ub); return 1;
+        case OP_SUB: *result = (int)(ua - ub); return 1;
+        case OP_MUL: *result = (int)(ua * ub); return 1;
+        case OP_DIV:
+            if (b == 0 || (a == INT_MIN && b == -1)) return 0;
+            *result = a / b;
+            return 1;
+        case OP_LT: *result = a < b; return 1;
+        default: return 0;
+    }
+}
+
+
+static void make_constant(FoldState* st, ASTNode* node, int value) {
+    st->stats->nodes_freed += discard_ast(node->left);
+    st->stats->nodes_freed += discard_ast(node->right);
+
+    node->type = NODE_INT;
+    node->value.ival = value;
+    node->left = NULL;
+    node->right = NULL;
+    st->stats->nodes_folded++;
+}
+
+
+static void push_value(FoldState* st, ASTNode* node) {
+    if (st->value_count == st->value_capacity) {
+        st->value_capacity = st->value_capacity ? st->value_capacity * 2 : 64;
+        st->values = (ASTNode**)xrealloc(st->values, st->value_capacity * sizeof(ASTNode*));
+    }
+    st->values[st->value_count++] = node;
+}
+
+
+/* New consed nodes get the span of the node they stand for. */
+static ASTNode* with_loc(ASTNode* node, SrcSpan loc) {
+    if (!node->loc.length) node->loc = loc;
+    return node;
+}
+
+
+static WalkAction fold_shared_node(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    FoldState* st = (FoldState*)ctx;
+    ASTNode* node = frame->node;
+    int result;
+    (void)walker;
+
+    switch (node->type) {
+        case NODE_VAR: {
+            Binding* b = lookup(st, node->value.sym);
+            if (b && b->known && b->loop_depth == st->loop_depth) {
+                push_value(st, with_loc(make_int_node(b->value), node->loc));
+                st->stats->nodes_folded++;
+                return WALK_CONTINUE;
+            }
+            break;
+        }
+
+        case NODE_BINOP: {
+            ASTNode* right = st->values[--st->value_count];
+            ASTNode* left = st->values[--st->value_count];
+
+            if (left->type == NODE_INT && right->type == NODE_INT &&
+                eval_binop(node->value.op, left->value.ival, right->value.ival, &result)) {
+                push_value(st, with_loc(make_int_node(result), node->loc));
+                st->stats->nodes_folded++;
+                return WALK_CONTINUE;
+            }
+            if (left != node->left || right != node->right) {
+                push_value(st, with_loc(make_binop_node(node->value.op, left, right), node->loc));
+                return WALK_CONTINUE;
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    push_value(st, node);
+    return WALK_CONTINUE;
+}
+
+
+/* Consed subtrees are shared by every place that uses the same
+   expression, so they are folded by building the result from consed
+   nodes rather than in place. Their children are consed as well. */
+static ASTNode* fold_shared(FoldState* st, ASTNode* node) {
+    st->value_count = 0;
+    ast_walk_node(&st->shared, &node, NULL, fold_shared_node, st);
+    return st->values[0];
+}
+
+
+static WalkAction fold_pre(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    FoldState* st = (FoldState*)ctx;
+    ASTNode* node = frame->node;
+
+    /* A for's init runs once; its condition, update and body repeat. */
+    WalkFrame* parent = walk_parent(walker, frame);
+    if (parent && parent->node->type == NODE_FOR && frame->link == &parent->node->right) {
+        st->loop_depth++;
+    }
+
+    if (AST_IS_CONSED(node)) {
+        ASTNode* folded = fold_shared(st, node);
+        if (folded != node) {
+            *frame->link = folded;
+            frame->node = folded;
+            discard_ast(node);
+        }
+        return WALK_SKIP;
+    }
+
+    switch (node->type) {
+        case NODE_VAR: {
+            /* Inside a loop only bindings made in the same iteration are
+               stable; anything older may be changed by a later ++/--. */
+            Binding* b = lookup(st, node->value.sym);
+            if (b && b->known && b->loop_depth == st->loop_depth) {
+                make_constant(st, node, b->value);
+            }
+            return WALK_CONTINUE;
+        }
+
+        case NODE_UNARY:
+            if (node->left && node->left->type == NODE_VAR) {
+                kill(st, node->left->value.sym);
+            }
+            return WALK_SKIP;
+
+        case NODE_IF:
+        case NODE_FOR:
+        case NODE_FUNC_DEF:
+            frame->data = st->count;
+            return WALK_CONTINUE;
+
+        default:
+            return WALK_CONTINUE;
+    }
+}
+
+
+static WalkAction fold_post(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    FoldState* st = (FoldState*)ctx;
+    ASTNode* node = frame->node;
+    int result;
+    (void)walker;
+
+    switch (node->type) {
+        case NODE_BINOP:
+            if (!AST_IS_CONSED(node) && node->left->type == NODE_INT && node->right->type == NODE_INT &&
+                eval_binop(node->value.op, node->left->value.ival, node->right->value.ival, &result)) {
+                make_constant(st, node, result);
+            }
+            break;
+
+        case NODE_DECL:
+            if (node->left && node->left->type == NODE_INT) {
+                bind(st, node->value.sym, 1, node->left->value.ival);
+            } else {
+                bind(st, node->value.sym, 0, 0);
+            }
+            break;
+
+        case NODE_FOR:
+            if (node->right) {
+                st->loop_depth--;
+            }
+            pop_scope(st, frame->data);
+            break;
+
+        case NODE_IF:
+        case NODE_FUNC_DEF:
+            pop_scope(st, frame->data);
+            break;
+
+        default:
+            break;
+    }
+
+    return WALK_CONTINUE;
+}
+
+
+void fold_constants(ASTNode* root, PassStats* stats) {
+    FoldState st = {0};
+    AstWalker walker;
+    double start = pass_time_ms();
+
+    stats->name = "constant-folding";
+    stats->nodes_folded = 0;
+    stats->nodes_freed = 0;
+    stats->evals_removed = 0;
+    st.stats = stats;
+
+    walker_init(&walker);
+    walker_init(&st.shared);
+    ast_walk(&walker, &root, fold_pre, fold_post, &st);
+    walker_free(&walker);
+    walker_free(&st.shared);
+
+    free(st.values);
+    free(st.bindings);
+    symmap_clear(&st.scopes);
+    stats->elapsed_ms = pass_time_ms() - start;
+}
+
+
+#define DCE_DEAD 1
+
+
+typedef struct {
+    SymMap uses;            /* name -> number of NODE_VAR reads */
+    int terminated;         /* a return has been reached in this block */
+    size_t decls_removed;
+    AstWalker scan;         /* for the helper walks below */
+    PassStats* stats;
+} DceState;
+
+
+typedef struct {
+    SymMap* uses;
+    int delta;
+} UseCount;
+
+
+static WalkAction count_var(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    UseCount* uc = (UseCount*)ctx;
+    (void)walker;
+
+    if (frame->node->type == NODE_VAR) {
+        symmap_insert(uc->uses, frame->node->value.sym, 0)->value += uc->delta;
+    }
+    return WALK_CONTINUE;
+}
+
+
+/* Adds delta to the use count of every name read in node and its siblings. */
+static void count_uses(AstWalker* walker, ASTNode* node, SymMap* uses, int delta) {
+    UseCount uc = { uses, delta };
+    ast_walk(walker, &node, count_var, NULL, &uc);
+}
+
+
+static WalkAction check_pure(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    (void)walker;
+
+    if (frame->node->type == NODE_FUNC_CALL || frame->node->type == NODE_UNARY) {
+        *(int*)ctx = 0;
+        return WALK_SKIP;
+    }
+    return WALK_CONTINUE;
+}
+
+
+static int is_pure(AstWalker* walker, ASTNode* node) {
+    int pure = 1;
+    ast_walk(walker, &node, check_pure, NULL, &pure);
+    return pure;
+}
+
+
+/* True if the block declares a name at its own level. */
+static int declares_names(const ASTNode* block) {
+    if (block->type != NODE_SEQ) return block->type == NODE_DECL;
+
+    for (unsigned i = 0; i < block->count; i++) {
+        if (block->value.items[i]->type == NODE_DECL) return 1;
+    }
+    return 0;
+}
+
+
+/* Unlinks a whole statement and hands it back to the allocator. */
+static void drop_stmt(DceState* st, WalkFrame* frame) {
+    ASTNode* stmt = frame->node;
+
+    *frame->link = stmt->next;
+    stmt->next = NULL;
+    count_uses(&st->scan, stmt->left, &st->uses, -1);
+    count_uses(&st->scan, stmt->right, &st->uses, -1);
+    st->stats->nodes_freed += discard_ast(stmt);
+    st->stats->nodes_folded++;
+}
+
+
+/* Only statement structure is walked; expressions are skipped. */
+static WalkAction dce_pre(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    DceState* st = (DceState*)ctx;
+    ASTNode* node = frame->node;
+    (void)walker;
+
+    if (st->terminated) {
+        frame->data = DCE_DEAD;
+        return WALK_SKIP;
+    }
+
+    switch (node->type) {
+        case NODE_SEQ:
+        case NODE_FOR:
+        case NODE_FUNC_DEF:
+            return WALK_CONTINUE;
+
+        case NODE_IF:
+            if (node->left->type == NODE_INT && node->left->value.ival == 0) {
+                frame->data = DCE_DEAD;
+                return WALK_SKIP;
+            }
+            return WALK_CONTINUE;
+
+        default:
+            return WALK_SKIP;
+    }
+}
+
+
+static WalkAction dce_post(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    DceState* st = (DceState*)ctx;
+    ASTNode* node = frame->node;
+    (void)walker;
+
+    if (frame->data == DCE_DEAD) {
+        drop_stmt(st, frame);
+        return WALK_CONTINUE;
+    }
+
+    switch (node->type) {
+        case NODE_SEQ:
+            /* Drops removed statements and inlines unwrapped if bodies. */
+            st->stats->nodes_freed += block_compact(node);
+            break;
+
+        case NODE_RETURN:
+            st->terminated = 1;
+            break;
+
+        case NODE_DECL: {
+            SymSlot* slot = symmap_find(&st->uses, node->value.sym);
+            if ((!slot || slot->value == 0) && is_pure(&st->scan, node->left)) {
+                drop_stmt(st, frame);
+                st->decls_removed++;
+            }
+            break;
+        }
+
+        case NODE_IF: {
+            ASTNode* body = node->right;
+
+            /* if (1) { ... } becomes its body, unless that would merge scopes. */
+            if (node->left->type == NODE_INT && body && !declares_names(body)) {
+                node->right = NULL;
+                drop_stmt(st, frame);
+                *frame->link = body;
+                break;
+            }
+
+            /* A return inside a conditional body does not end this block. */
+            st->terminated = 0;
+            if ((!body || (body->type == NODE_SEQ && body->count == 0)) && is_pure(&st->scan, node->left)) {
+                drop_stmt(st, frame);
+            }
+            break;
+        }
+
+        case NODE_FOR:
+            st->terminated = 0;
+            break;
+
+        default:
+            break;
+    }
+
+    return WALK_CONTINUE;
+}
+
+
+void eliminate_dead_code(ASTNode* root, PassStats* stats) {
+    DceState st = {0};
+    AstWalker walker;
+    double start = pass_time_ms();
+
+    stats->name = "dead-code";
+    stats->nodes_folded = 0;
+    stats->nodes_freed = 0;
+    stats->evals_removed = 0;
+    st.stats = stats;
+
+    walker_init(&walker);
+    walker_init(&st.scan);
+    count_uses(&st.scan, root, &st.uses, 1);
+
+    /* Dropping a declaration can leave the ones it read unused, so repeat
+       until no declaration goes away. */
+    for (ASTNode* fn = root; fn; fn = fn->next) {
+        if (fn->type != NODE_FUNC_DEF) continue;
+
+        do {
+            st.terminated = 0;
+            st.decls_removed = 0;
+            ast_walk_node(&walker, &fn, dce_pre, dce_post, &st);
+        } while (st.decls_removed);
+    }
+
+    walker_free(&walker);
+    walker_free(&st.scan);
+    symmap_clear(&st.uses);
+    stats->elapsed_ms = pass_time_ms() - start;
+}
+
+
+/* A pure expression seen in the current block. */
+typedef struct {
+    ASTNode* node;          /* first occurrence, later the temporary's initializer */
+    ASTNode** link;         /* where the first occurrence hangs */
+    uint64_t hash;
+    unsigned stmt;          /* block index of the statement holding it */
+    int serial;             /* number of that statement within the pass */
+    size_t uses;            /* occurrences, the first one included */
+    const char* temp;
+    int shared;             /* `link` is a field of a consed node */
+} CseExpr;
+
+
+/* A later occurrence of exprs[expr], to be replaced by its temporary. */
+typedef struct {
+    ASTNode** link;
+    size_t expr;
+    unsigned stmt;
+    int shared;
+} CseUse;
+
+
+typedef struct {
+    CseExpr* exprs;
+    size_t expr_count;
+    size_t expr_capacity;
+    CseUse* uses;
+    size_t use_count;
+    size_t use_capacity;
+    size_t* table;          /* exprs index + 1 by hash, open addressing */
+    size_t table_capacity;
+    size_t table_count;
+    uint64_t* hashes;       /* by pre-order index in the region being scanned */
+    size_t* ends;           /* by pre-order index: the index just past its subtree */
+    size_t hash_capacity;
+    size_t skip_end;        /* cse_find passes over indexes below this */
+    uint64_t* values;       /* hashes of the children being combined */
+    size_t value_count;
+    size_t value_capacity;
+    const ASTNode** pairs;  /* cse_same's work list */
+    size_t pair_capacity;
+    ASTNode** wrap;         /* by block index: the statement behind its temporaries */
+    size_t wrap_capacity;
+    SymMap modified;        /* name -> serial of the last statement that changed it */
+    int serial;
+    unsigned stmt;
+    unsigned temps;
+    int impure;
+    AstWalker scan;
+    PassStats* stats;
+} CseState;
+
+
+static uint64_t cse_mix(uint64_t h, uint64_t v) {
+    h = (h ^ v) * 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 29);
+}
+
+
+/* Post-order: children leave their hashes on the value stack and count
+   themselves in their parent's data. Anything but INT, VAR and BINOP
+   over those hashes to 0; the others have their low bit set, since a
+   mix can come out as 0 too (cse_mix(1, 1) does). */
+static WalkAction cse_hash(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    CseState* st = (CseState*)ctx;
+    ASTNode* node = frame->node;
+    uint64_t h = 0;
+
+    st->value_count -= frame->data;
+    switch (node->type) {
+        case NODE_INT:
+            h = cse_mix(1, (unsigned)node->value.ival) | 1;
+            break;
+        case NODE_VAR:
+            h = cse_mix(2, (uintptr_t)node->value.sym) | 1;
+            break;
+        case NODE_BINOP: {
+            const uint64_t* child = &st->values[st->value_count];
+            if (frame->data == 2 && child[0] && child[1]) {
+                h = cse_mix(cse_mix(cse_mix(3, node->value.op), child[0]), child[1]) | 1;
+            }
+            break;
+        }
+        case NODE_UNARY:
+            st->impure = 1;
+            break;
+        default:
+            break;
+    }
+
+    if (frame->order >= st->hash_capacity) {
+        while (frame->order >= st->hash_capacity) {
+            st->hash_capacity = st->hash_capacity ? st->hash_capacity * 2 : 256;
+        }
+        st->hashes = (uint64_t*)xrealloc(st->hashes, st->hash_capacity * sizeof(uint64_t));
+        st->ends = (size_t*)xrealloc(st->ends, st->hash_capacity * sizeof(size_t));
+    }
+    st->hashes[frame->order] = h;
+    st->ends[frame->order] = walker->visited;
+
+    WalkFrame* parent = walk_parent(walker, frame);
+    if (parent) {
+        if (st->value_count == st->value_capacity) {
+            st->value_capacity = st->value_capacity ? st->value_capacity * 2 : 64;
+            st->values = (uint64_t*)xrealloc(st->values, st->value_capacity * sizeof(uint64_t));
+        }
+        st->values[st->value_count++] = h;
+        parent->data++;
+    }
+    return WALK_CONTINUE;
+}
+
+
+/* 1 if `b` computes the same value as the expression first seen at
+   statement `serial`, 0 if it has a different shape, -1 if the shape
+   matches but a variable it reads has changed since. */
+static int cse_same(CseState* st, const ASTNode* a, const ASTNode* b, int serial) {
+    size_t top = 0;
+    int stale = 0;
+
+    if (st->pair_capacity < 2) {
+        st->pair_capacity = 64;
+        st->pairs = (const ASTNode**)xrealloc((void*)st->pairs, st->pair_capacity * sizeof(ASTNode*));
+    }
+    st->pairs[top++] = a;
+    st->pairs[top++] = b;
+    while (top) {
+        b = st->pairs[--top];
+        a = st->pairs[--top];
+        if (a->type != b->type) return 0;
+
+        switch (a->type) {
+            case NODE_INT:
+                if (a->value.ival != b->value.ival) return 0;
+                break;
+            case NODE_VAR: {
+                if (a->value.sym != b->value.sym) return 0;
+                SymSlot* slot = symmap_find(&st->modified, a->value.sym);
+                if (slot && slot->value >= serial) stale = 1;
+                break;
+            }
+            case NODE_BINOP:
+                if (a->value.op != b->value.op) return 0;
+                if (top + 4 > st->pair_capacity) {
+                    st->pair_capacity = st->pair_capacity * 2 + 64;
+                    st->pairs = (const ASTNode**)xrealloc((void*)st->pairs, st->pair_capacity * sizeof(ASTNode*));
+                }
+                st->pairs[top++] = a->left;
+                st->pairs[top++] = b->left;
+                st->pairs[top++] = a->right;
+                st->pairs[top++] = b->right;
+                break;
+            default:
+                return 0;
+        }
+    }
+    return stale ? -1 : 1;
+}
+
+
+static void cse_table_grow(CseState* st) {
+    size_t capacity = st->table_capacity ? st->table_capacity * 2 : 256;
+    size_t* table = (size_t*)calloc(capacity, sizeof(size_t));
+    if (!table) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < st->table_capacity; i++) {
+        if (!st->table[i]) continue;
+        size_t j = st->exprs[st->table[i] - 1].hash & (capacity - 1);
+        while (table[j]) {
+            j = (j + 1) & (capacity - 1);
+        }
+        table[j] = st->table[i];
+    }
+
+    free(st->table);
+    st->table = table;
+    st->table_capacity = capacity;
+}
+
+
+/* Pre-order over a statement's expressions: the first time a pure
+   BINOP is seen it is recorded, later occurrences become uses and their
+   parts are not looked at. The parts are still walked, not skipped, so
+   the pre-order indexes stay those cse_hash used. */
+static WalkAction cse_find(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    CseState* st = (CseState*)ctx;
+    ASTNode* node = frame->node;
+    uint64_t h = st->hashes[frame->order];
+
+    if (frame->order < st->skip_end) return WALK_CONTINUE;
+    if (node->type != NODE_BINOP || !h) return WALK_CONTINUE;
+
+    WalkFrame* parent = walk_parent(walker, frame);
+    int shared = parent && AST_IS_CONSED(parent->node);
+
+    if (2 * (st->table_count + 1) > st->table_capacity) {
+        cse_table_grow(st);
+    }
+
+    size_t mask = st->table_capacity - 1;
+    size_t i = h & mask;
+    for (; st->table[i]; i = (i + 1) & mask) {
+        CseExpr* e = &st->exprs[st->table[i] - 1];
+        if (e->hash != h) continue;
+
+        int same = cse_same(st, e->node, node, e->serial);
+        if (same > 0) {
+            if (st->use_count == st->use_capacity) {
+                st->use_capacity = st->use_capacity ? st->use_capacity * 2 : 64;
+                st->uses = (CseUse*)xrealloc(st->uses, st->use_capacity * sizeof(CseUse));
+            }
+            st->uses[st->use_count].link = frame->link;
+            st->uses[st->use_count].expr = st->table[i] - 1;
+            st->uses[st->use_count].stmt = st->stmt;
+            st->uses[st->use_count].shared = shared;
+            st->use_count++;
+            e->uses++;
+            st->skip_end = st->ends[frame->order];
+            return WALK_CONTINUE;
+        }
+        if (same < 0) break;    /* this occurrence takes the stale one's slot */
+    }
+
+    if (st->expr_count == st->expr_capacity) {
+        st->expr_capacity = st->expr_capacity ? st->expr_capacity * 2 : 64;
+        st->exprs = (CseExpr*)xrealloc(st->exprs, st->expr_capacity * sizeof(CseExpr));
+    }
+    CseExpr* e = &st->exprs[st->expr_count++];
+    e->node = node;
+    e->link = frame->link;
+    e->hash = h;
+    e->stmt = st->stmt;
+    e->serial = st->serial;
+    e->uses = 1;
+    e->temp = NULL;
+    e->shared = shared;
+    if (!st->table[i]) st->table_count++;
+    st->table[i] = st->expr_count;
+    return WALK_CONTINUE;
+}
+
+
+static void cse_scan(CseState* st, ASTNode** link) {
+    if (!*link) return;
+
+    st->impure = 0;
+    st->value_count = 0;
+    ast_walk_node(&st->scan, link, NULL, cse_hash, st);
+    if (!st->impure) {
+        st->skip_end = 0;
+        ast_walk_node(&st->scan, link, cse_find, NULL, st);
+    }
+}
+
+
+static WalkAction cse_kill(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    CseState* st = (CseState*)ctx;
+    ASTNode* node = frame->node;
+    (void)walker;
+
+    if (node->type == NODE_UNARY && node->left && node->left->type == NODE_VAR) {
+        symmap_insert(&st->modified, node->left->value.sym, 0)->value = st->serial;
+    }
+    return WALK_CONTINUE;
+}
+
+
+static WalkAction count_binop(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    (void)walker;
+    if (frame->node->type == NODE_BINOP) (*(size_t*)ctx)++;
+    return WALK_CONTINUE;
+}
+
+
+static ASTNode* cse_var(const char* temp, SrcSpan loc) {
+    ASTNode* var = make_var_node(temp);
+    if (!var->loc.length) var->loc = loc;
+    return var;
+}
+
+
+/* Declares a temporary for every expression used more than once, right
+   before the statement that first computes it, and reads it everywhere. */
+static void cse_rewrite(CseState* st, ASTNode* block) {
+    size_t temps = 0;
+
+    if (block->count > st->wrap_capacity) {
+        st->wrap_capacity = block->count;
+        st->wrap = (ASTNode**)xrealloc(st->wrap, st->wrap_capacity * sizeof(ASTNode*));
+    }
+    memset(st->wrap, 0, block->count * sizeof(ASTNode*));
+
+    /* Latest first: a part of an expression's first occurrence was seen
+       after it, and its temporary must be declared before it. */
+    for (size_t k = st->expr_count; k-- > 0;) {
+        CseExpr* e = &st->exprs[k];
+        if (e->uses < 2) continue;
+
+        char name[32];
+        int len = snprintf(name, sizeof(name), "__cse%u", st->temps++);
+        e->temp = ast_intern(name, (size_t)len);
+
+        ASTNode* decl = make_decl_node(e->temp, e->node);
+        decl->loc = e->node->loc;
+        *e->link = cse_var(e->temp, e->node->loc);
+
+        if (st->wrap[e->stmt]) {
+            list_append(st->wrap[e->stmt], decl);
+        } else {
+            st->wrap[e->stmt] = make_block_node(decl);
+        }
+        temps++;
+    }
+    if (!temps) return;
+
+    size_t removed = 0;
+    for (size_t k = 0; k < st->use_count; k++) {
+        CseUse* u = &st->uses[k];
+        ASTNode* old = *u->link;
+        size_t ops = 0;
+
+        ast_walk_node(&st->scan, &old, count_binop, NULL, &ops);
+        removed += st->scan.visited - 1;
+        st->stats->evals_removed += ops;
+        st->stats->nodes_folded++;
+
+        *u->link = cse_var(st->exprs[u->expr].temp, old->loc);
+        discard_ast(old);
+    }
+    /* Each temporary adds its declaration and the read that replaced the
+       first occurrence. */
+    st->stats->nodes_freed += removed - 2 * temps;
+
+    /* The statement goes after its temporaries in a nested block, which
+       block_compact then inlines. */
+    for (unsigned i = 0; i < block->count; i++) {
+        if (st->wrap[i]) {
+            list_append(st->wrap[i], block->value.items[i]);
+            block->value.items[i] = st->wrap[i];
+        }
+    }
+    block_compact(block);
+}
+
+
+/* The part of a statement whose expressions are looked at, or NULL.
+   Loops are left to the blocks inside them. */
+static ASTNode** cse_region(ASTNode** link) {
+    ASTNode* stmt = *link;
+
+    switch (stmt->type) {
+        case NODE_DECL:
+        case NODE_RETURN:
+        case NODE_IF:
+            return &stmt->left;
+        case NODE_FOR:
+        case NODE_SEQ:
+            return NULL;
+        default:
+            return link;
+    }
+}
+
+
+static void cse_analyze(CseState* st, ASTNode* block) {
+    st->expr_count = 0;
+    st->use_count = 0;
+    if (st->table_count) {
+        memset(st->table, 0, st->table_capacity * sizeof(size_t));
+        st->table_count = 0;
+    }
+
+    for (unsigned i = 0; i < block->count; i++) {
+        ASTNode** link = &block->value.items[i];
+        ASTNode** region = cse_region(link);
+
+        st->stmt = i;
+        st->serial++;
+        if (region) cse_scan(st, region);
+
+        /* Changes made by this statement are seen from the next one on. */
+        ast_walk_node(&st->scan, link, cse_kill, NULL, st);
+        if ((*link)->type == NODE_DECL) {
+            symmap_insert(&st->modified, (*link)->value.sym, 0)->value = st->serial;
+        }
+    }
+}
+
+
+static WalkAction cse_unshare(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    ASTNode* node = frame->node;
+    (void)walker;
+    (void)ctx;
+
+    if (node->left && node->left->type == NODE_BINOP) node->left = ast_unshare(node->left);
+    if (node->right && node->right->type == NODE_BINOP) node->right = ast_unshare(node->right);
+    if (AST_HAS_ITEMS(node)) {
+        for (unsigned i = 0; i < node->count; i++) {
+            if (node->value.items[i]->type == NODE_BINOP) {
+                node->value.items[i] = ast_unshare(node->value.items[i]);
+            }
+        }
+    }
+    return WALK_CONTINUE;
+}
+
+
+/* Gives the statement private copies of the shared operators in its
+   expressions, so any of their links can be rewritten. */
+static void cse_unshare_stmt(CseState* st, ASTNode** link) {
+    ASTNode** region = cse_region(link);
+
+    if (!region) return;
+    if ((*region)->type == NODE_BINOP) *region = ast_unshare(*region);
+    ast_walk_node(&st->scan, region, cse_unshare, NULL, NULL);
+}
+
+
+static void cse_block(CseState* st, ASTNode* block) {
+    int shared = 0;
+
+    cse_analyze(st, block);
+
+    /* With hash-consing, an occurrence may hang inside a node other
+       statements share. The statements holding such occurrences get
+       their own copies and the block is looked at again; that finds the
+       same expressions, now with links that can be replaced. It runs on
+       new serials, so the changes the first look recorded are older
+       than anything it finds. */
+    for (size_t k = 0; k < st->expr_count; k++) {
+        CseExpr* e = &st->exprs[k];
+        if (e->uses > 1 && e->shared) {
+            cse_unshare_stmt(st, &block->value.items[e->stmt]);
+            shared = 1;
+        }
+    }
+    for (size_t k = 0; k < st->use_count; k++) {
+        CseUse* u = &st->uses[k];
+        if (u->shared) {
+            cse_unshare_stmt(st, &block->value.items[u->stmt]);
+            shared = 1;
+        }
+    }
+    if (shared) {
+        cse_analyze(st, block);
+    }
+
+    cse_rewrite(st, block);
+}
+
+
+static WalkAction cse_visit(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    (void)walker;
+
+    switch (frame->node->type) {
+        case NODE_SEQ:
+            cse_block((CseState*)ctx, frame->node);
+            return WALK_CONTINUE;
+        case NODE_IF:
+        case NODE_FOR:
+        case NODE_FUNC_DEF:
+            return WALK_CONTINUE;
+        default:
+            return WALK_SKIP;
+    }
+}
+
+
+void eliminate_common_subexpressions(ASTNode* root, PassStats* stats) {
+    CseState st = {0};
+    AstWalker walker;
+    double start = pass_time_ms();
+
+    stats->name = "common-subexpr";
+    stats->nodes_folded = 0;
+    stats->nodes_freed = 0;
+    stats->evals_removed = 0;
+    st.stats = stats;
+
+    walker_init(&walker);
+    walker_init(&st.scan);
+    ast_walk(&walker, &root, cse_visit, NULL, &st);
+    walker_free(&walker);
+    walker_free(&st.scan);
+
+    free(st.exprs);
+    free(st.uses);
+    free(st.table);
+    free(st.hashes);
+    free(st.ends);
+    free(st.values);
+    free((void*)st.pairs);
+    free(st.wrap);
+    symmap_clear(&st.modified);
+    stats->elapsed_ms = pass_time_ms() - start;
+}
+
+
+void print_pass_stats(const PassStats* stats, FILE* output) {
+    fprintf(output, "%-18s %8zu folded %8zu freed %10.3f ms",
+            stats->name, stats->nodes_folded, stats->nodes_freed, stats->elapsed_ms);
+    if (stats->evals_removed) {
+        fprintf(output, " %8zu evaluations removed", stats->evals_removed);
+    }
+    fputc('\n', output);
+}
+
@@ -0,0 +1,54 @@
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include <stdio.h>
+#include "ast.h"
+
+
+/* Bumped whenever the passes change what they produce, so trees
+   optimized by an older build are not reused (see cache.c). */
+#define OPTIMIZE_VERSION 4
+
+
+typedef struct {
+    const char* name;
+    size_t nodes_folded;   /* nodes rewritten or statements removed */
+    size_t nodes_freed;    /* nodes taken out of the tree */
+    size_t evals_removed;  /* operators no longer evaluated (per occurrence in the source) */
+    double elapsed_ms;
+} PassStats;
+
+
+/* Folds constant NODE_BINOP subtrees and replaces NODE_VAR reads of
+   variables with a known constant value, in one walk over the tree. */
+void fold_constants(ASTNode* root, PassStats* stats);
+
+
+/* Removes if statements with a constant false condition (and unwraps
+   constant true ones), declarations of names that are never read whose
+   initializer has no side effects, and statements after a return. */
+void eliminate_dead_code(ASTNode* root, PassStats* stats);
+
+
+/* Within each NODE_SEQ block, finds BINOP expressions over variables
+   and constants that are computed by more than one statement with no
+   change to their variables in between. Each gets a temporary declared
+   just before the first statement that computes it; every occurrence
+   then reads the temporary. Statements with a ++ or -- in the scanned
+   expression are left alone, and loops are only looked into as blocks
+   of their own. */
+void eliminate_common_subexpressions(ASTNode* root, PassStats* stats);
+
+
+/* Evaluates a constant binary operation; returns 0 when it must not be
+   folded (division by zero or overflow in the division). */
+int eval_binop(OpKind op, int a, int b, int* result);
+
+
+/* Monotonic clock used for PassStats timings. */
+double pass_time_ms(void);
+
+
+void print_pass_stats(const PassStats* stats, FILE* output);
+
+#endif
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "outbuf.h"
+
+
+#define INDENT_CHUNK 128
+
+
+static const char indent_spaces[2 * INDENT_CHUNK + 1] =
+    "                                                                "
+    "                                                                "
+    "                                                                "
+    "                                                                ";
+
+
+void outbuf_init(OutBuf* out, FILE* file) {
+    out->file = file;
+    out->data = (char*)malloc(OUTBUF_SIZE);
+    if (!out->data) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    out->used = 0;
+    out->bytes_written = 0;
+}
+
+
+void outbuf_flush(OutBuf* out) {
+    if (out->used) {
+        fwrite(out->data, 1, out->used, out->file);
+        out->used = 0;
+    }
+}
+
+
+void outbuf_close(OutBuf* out) {
+    outbuf_flush(out);
+    free(out->data);
+    out->data = NULL;
+}
+
+
+void outbuf_write(OutBuf* out, const char* data, size_t len) {
+    out->bytes_written += len;
+
+    if (len > OUTBUF_SIZE - out->used) {
+        outbuf_flush(out);
+        if (len > OUTBUF_SIZE) {
+            fwrite(data, 1, len, out->file);
+            return;
+        }
+    }
+
+    memcpy(out->data + out->used, data, len);
+    out->used += len;
+}
+
+
+void outbuf_puts(OutBuf* out, const char* str) {
+    outbuf_write(out, str, strlen(str));
+}
+
+
+void outbuf_putc(OutBuf* out, char c) {
+    if (out->used == OUTBUF_SIZE) {
+        outbuf_flush(out);
+    }
+    out->data[out->used++] = c;
+    out->bytes_written++;
+}
+
+
+void outbuf_int(OutBuf* out, long value) {
+    char digits[24];
+    char* p = digits + sizeof(digits);
+    unsigned long magnitude = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+
+    do {
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+
+    if (value < 0) {
+        *--p = '-';
+    }
+    outbuf_write(out, p, (size_t)(digits + sizeof(digits) - p));
+}
+
+
+void outbuf_escaped(OutBuf* out, const char* str) {
+    const char* start = str;
+
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\') {
+            outbuf_write(out, start, (size_t)(str - start));
+            outbuf_putc(out, '\\');
+            start = str;
+        }
+    }
+    outbuf_write(out, start, (size_t)(str - start));
+}
+
+
+void outbuf_indent(OutBuf* out, size_t levels) {
+    while (levels > INDENT_CHUNK) {
+        outbuf_write(out, indent_spaces, 2 * INDENT_CHUNK);
+        levels -= INDENT_CHUNK;
+    }
+    outbuf_write(out, indent_spaces, 2 * levels);
+}
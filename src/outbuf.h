@@ -0,0 +1,43 @@
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+
+#define OUTBUF_SIZE (256 * 1024)
+
+
+/* Output sink that formats into one large buffer and hands it to the
+   FILE in OUTBUF_SIZE chunks, so printing costs one fwrite per chunk
+   rather than several fprintf calls per line. */
+typedef struct {
+    FILE* file;
+    char* data;
+    size_t used;
+    size_t bytes_written;   /* total bytes passed to the sink */
+} OutBuf;
+
+
+void outbuf_init(OutBuf* out, FILE* file);
+
+void outbuf_flush(OutBuf* out);
+
+/* Flushes and releases the buffer; the FILE stays open. */
+void outbuf_close(OutBuf* out);
+
+void outbuf_write(OutBuf* out, const char* data, size_t len);
+
+void outbuf_puts(OutBuf* out, const char* str);
+
+void outbuf_putc(OutBuf* out, char c);
+
+void outbuf_int(OutBuf* out, long value);
+
+/* Writes str with backslashes and double quotes backslash-escaped. */
+void outbuf_escaped(OutBuf* out, const char* str);
+
+/* Writes `levels` two-space indentation steps from a precomputed string. */
+void outbuf_indent(OutBuf* out, size_t levels);
+
+#endif
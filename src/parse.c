@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parse.h"
+#include "parser.tab.h"
+
+
+/* Defined in lex.yy.c, which has no header of its own. */
+int yylex_init_extra(Parser* extra, yyscan_t* scanner);
+int yylex_destroy(yyscan_t scanner);
+void yyrestart(FILE* file, yyscan_t scanner);
+struct yy_buffer_state* yy_scan_buffer(char* base, size_t size, yyscan_t scanner);
+void yy_delete_buffer(struct yy_buffer_state* buffer, yyscan_t scanner);
+int yylex(YYSTYPE* lvalp, YYLTYPE* llocp, yyscan_t scanner);
+
+
+/* Token values are copied to and from the grammar's %union as bytes. */
+_Static_assert(sizeof(TokenValue) <= sizeof(YYSTYPE), "TokenValue larger than YYSTYPE");
+
+
+void parser_init(Parser* parser) {
+    if (yylex_init_extra(parser, &parser->scanner) != 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    parser->name = NULL;
+    parser->source = NULL;
+    parser->offset = 0;
+    parser->lexer = LEXER_FLEX;
+    parser->next = NULL;
+    parser->root = NULL;
+}
+
+
+void parser_free(Parser* parser) {
+    yylex_destroy(parser->scanner);
+    parser->scanner = NULL;
+}
+
+
+/* The grammar's yylex when no tokens were scanned ahead. `source` is
+   only set for a buffer, the one input the hand-written scanner takes. */
+int parser_lex(YYSTYPE* lvalp, YYLTYPE* llocp, Parser* parser) {
+    if (parser->lexer == LEXER_SIMD && parser->source) {
+        return simd_lex(&parser->simd, lvalp, llocp);
+    }
+    return yylex(lvalp, llocp, parser->scanner);
+}
+
+
+static void begin(Parser* parser, const char* source, const char* name) {
+    parser->name = name;
+    parser->source = source;
+    parser->offset = 0;
+    parser->next = NULL;
+    parser->root = NULL;
+}
+
+
+/* Points the selected lexer at data[0..size). Returns 0 if flex would
+   not take the buffer. */
+static int begin_buffer(Parser* parser, char* data, size_t size, const char* name,
+                        struct yy_buffer_state** buffer) {
+    begin(parser, data, name);
+    *buffer = NULL;
+    if (parser->lexer == LEXER_SIMD) {
+        simd_lex_init(&parser->simd, data, size);
+        return 1;
+    }
+    *buffer = yy_scan_buffer(data, size + 2, parser->scanner);
+    return *buffer != NULL;
+}
+
+
+static void end_buffer(Parser* parser, struct yy_buffer_state* buffer) {
+    if (buffer) yy_delete_buffer(buffer, parser->scanner);
+}
+
+
+ASTNode* parser_parse(Parser* parser, FILE* file, const char* name) {
+    begin(parser, NULL, name);
+    yyrestart(file, parser->scanner);
+    if (yyparse(parser->scanner, parser) != 0) {
+        return NULL;
+    }
+    return parser->root;
+}
+
+
+ASTNode* parser_parse_buffer(Parser* parser, char* data, size_t size, const char* name) {
+    struct yy_buffer_state* buffer;
+    if (!begin_buffer(parser, data, size, name, &buffer)) return NULL;
+
+    int failed = yyparse(parser->scanner, parser);
+    end_buffer(parser, buffer);
+    return failed ? NULL : parser->root;
+}
+
+
+size_t parser_tokenize(Parser* parser, char* data, size_t size, const char* name, TokenBuffer* tokens) {
+    struct yy_buffer_state* buffer;
+
+    token_buffer_reset(tokens);
+    if (!begin_buffer(parser, data, size, name, &buffer)) return 0;
+
+    /* Flex leaves the span alone at the end of input, so the end token
+       gets the last one set, as the grammar would have seen it. The
+       value is copied whole whatever the kind, since branching on the
+       kind mispredicts; tokens without a value keep a stale one. */
+    int simd = parser->lexer == LEXER_SIMD;
+    SrcSpan loc = { 0, 0 };
+    YYSTYPE value;
+    size_t count = 0;
+    int kind;
+
+    memset(&value, 0, sizeof(value));
+    do {
+        kind = simd ? simd_lex(&parser->simd, &value, &loc)
+                    : yylex(&value, &loc, parser->scanner);
+        if (count == tokens->capacity) token_buffer_grow(tokens);
+
+        Token* token = &tokens->items[count++];
+        token->kind = kind;
+        token->loc = loc;
+        memcpy(&token->value, &value, sizeof(token->value));
+    } while (kind != 0);
+
+    tokens->count = count;
+    end_buffer(parser, buffer);
+    return count - 1;
+}
+
+
+ASTNode* parser_parse_tokens(Parser* parser, const TokenBuffer* tokens, const char* source, const char* name) {
+    if (tokens->count == 0 || tokens->items[tokens->count - 1].kind != 0) return NULL;
+
+    begin(parser, source, name);
+    parser->next = tokens->items;
+    int failed = yyparse(parser->scanner, parser);
+    parser->next = NULL;
+    return failed ? NULL : parser->root;
+}
+
+
+static int same_token(int kind, const YYSTYPE* a, const YYLTYPE* aloc,
+                      const YYSTYPE* b, const YYLTYPE* bloc) {
+    if (aloc->offset != bloc->offset || aloc->length != bloc->length) return 0;
+    switch (kind) {
+        case IDENTIFIER:
+        case STRING:
+            return a->str == b->str;      /* both interned */
+        case NUMBER:
+            return a->ival == b->ival;
+        default:
+            return 1;
+    }
+}
+
+
+int parser_check_lexers(Parser* parser, const char* data, size_t size, const char* name) {
+    char* copy = (char*)malloc(size + 2);
+    if (!copy) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    memcpy(copy, data, size);
+    copy[size] = copy[size + 1] = '\0';
+
+    begin(parser, copy, name);
+
+    struct yy_buffer_state* buffer = yy_scan_buffer(copy, size + 2, parser->scanner);
+    if (!buffer) {
+        free(copy);
+        return 0;
+    }
+
+    SimdLexer simd;
+    simd_lex_init(&simd, data, size);
+
+    /* The end of input leaves the span alone, so both start out equal. */
+    YYSTYPE flex_value, simd_value;
+    YYLTYPE flex_loc = { 0, 0 }, simd_loc = { 0, 0 };
+    size_t tokens = 0;
+    int agree = 1;
+
+    for (;;) {
+        int flex_kind = yylex(&flex_value, &flex_loc, parser->scanner);
+        int simd_kind = simd_lex(&simd, &simd_value, &simd_loc);
+
+        if (flex_kind != simd_kind || !same_token(flex_kind, &flex_value, &flex_loc, &simd_value, &simd_loc)) {
+            fprintf(stderr, "%s: lexers differ at token %zu: flex %d at %u+%u, %s %d at %u+%u\n",
+                    name, tokens, flex_kind, flex_loc.offset, flex_loc.length,
+                    simd_lex_isa(), simd_kind, simd_loc.offset, simd_loc.length);
+            agree = 0;
+            break;
+        }
+        if (flex_kind == 0) break;
+        tokens++;
+    }
+
+    yy_delete_buffer(buffer, parser->scanner);
+    free(copy);
+    return agree;
+}
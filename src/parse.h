@@ -0,0 +1,64 @@
+#ifndef PARSE_H
+#define PARSE_H
+
+#include <stdio.h>
+#include "ast.h"
+#include "simdlex.h"
+#include "tokens.h"
+
+
+/* Scanner used by the buffer entry points; a FILE is always read by
+   flex. Both give the same tokens. */
+typedef enum {
+    LEXER_FLEX,
+    LEXER_SIMD
+} LexerKind;
+
+
+/* One reentrant lexer/parser pair and the result of its last parse.
+   Parsers share no state, so each thread can drive its own; the nodes
+   go to the calling thread's AST arena. */
+typedef struct {
+    void* scanner;        /* flex yyscan_t */
+    const char* name;     /* input name for error messages */
+    const char* source;   /* text being parsed, for error positions; NULL for a FILE */
+    uint32_t offset;      /* scanner position, used to give tokens their spans */
+    LexerKind lexer;      /* LEXER_FLEX unless set after parser_init */
+    SimdLexer simd;
+    const Token* next;    /* tokens scanned ahead; NULL: pull from the scanner */
+    ASTNode* root;
+} Parser;
+
+
+void parser_init(Parser* parser);
+
+void parser_free(Parser* parser);
+
+/* Parses `file` from the start; returns its AST, or NULL after a syntax
+   error. The scanner's buffers are reused from one call to the next.
+   Every node's `loc` is set to the span of source text it came from. */
+ASTNode* parser_parse(Parser* parser, FILE* file, const char* name);
+
+/* Like parser_parse, but scans data[0..size) in place with no copying.
+   data[size] and data[size + 1] must be NUL (see SourceBuffer) and stay
+   writable, as the scanner marks token ends in the buffer while it runs. */
+ASTNode* parser_parse_buffer(Parser* parser, char* data, size_t size, const char* name);
+
+/* Scans all of data[0..size), under the same conditions as
+   parser_parse_buffer, into `tokens`, ending with the end of input.
+   Returns the number of tokens before the end. Identifiers are interned
+   into the calling thread's AST arena, where the tree will go. */
+size_t parser_tokenize(Parser* parser, char* data, size_t size, const char* name, TokenBuffer* tokens);
+
+/* Parses the output of parser_tokenize, which gives the same tree as
+   parser_parse_buffer; `source` is the text it scanned, for error
+   positions. */
+ASTNode* parser_parse_tokens(Parser* parser, const TokenBuffer* tokens, const char* source, const char* name);
+
+/* Scans data[0..size) with both lexers and compares kinds, spans and
+   values token by token. Returns 1 if they agree; otherwise reports the
+   first difference on stderr and returns 0. flex runs over a copy, so
+   data is not written to. */
+int parser_check_lexers(Parser* parser, const char* data, size_t size, const char* name);
+
+#endif
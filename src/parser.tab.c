@@ -55,7 +55,7 @@
 #define YYSKELETON_NAME "yacc.c"
 
 /* Pure parsers.  */
-#define YYPURE 0
+#define YYPURE 2
 
 /* Push parsers.  */
 #define YYPUSH 0
@@ -67,17 +67,13 @@
 
 
 /* First part of user prologue.  */
-#line 5 "parser.y"
+#line 11 "parser.y"
 
 #include <stdio.h>
+#include <string.h>
 #include "ast.h"
 
-extern int yylex();
-void yyerror(const char* s) { fprintf(stderr, "Parse error: %s\n", s); }
-
-ASTNode* ast_root;
-
-#line 81 "parser.tab.c"
+#line 77 "parser.tab.c"
 
 # ifndef YY_CAST
 #  ifdef __cplusplus
@@ -131,23 +127,83 @@ enum yysymbol_kind_t
   YYSYMBOL_DECR = 23,                      /* DECR  */
   YYSYMBOL_YYACCEPT = 24,                  /* $accept  */
   YYSYMBOL_program = 25,                   /* program  */
-  YYSYMBOL_function = 26,                  /* function  */
-  YYSYMBOL_type = 27,                      /* type  */
-  YYSYMBOL_stmt_list = 28,                 /* stmt_list  */
-  YYSYMBOL_compound_stmt = 29,             /* compound_stmt  */
-  YYSYMBOL_stmt = 30,                      /* stmt  */
-  YYSYMBOL_decl_stmt = 31,                 /* decl_stmt  */
-  YYSYMBOL_if_stmt = 32,                   /* if_stmt  */
-  YYSYMBOL_for_init = 33,                  /* for_init  */
-  YYSYMBOL_for_stmt = 34,                  /* for_stmt  */
-  YYSYMBOL_return_stmt = 35,               /* return_stmt  */
-  YYSYMBOL_expr = 36,                      /* expr  */
-  YYSYMBOL_expr_list = 37                  /* expr_list  */
+  YYSYMBOL_function_list = 26,             /* function_list  */
+  YYSYMBOL_function = 27,                  /* function  */
+  YYSYMBOL_type = 28,                      /* type  */
+  YYSYMBOL_stmt_list = 29,                 /* stmt_list  */
+  YYSYMBOL_compound_stmt = 30,             /* compound_stmt  */
+  YYSYMBOL_stmt = 31,                      /* stmt  */
+  YYSYMBOL_decl_stmt = 32,                 /* decl_stmt  */
+  YYSYMBOL_if_stmt = 33,                   /* if_stmt  */
+  YYSYMBOL_for_init = 34,                  /* for_init  */
+  YYSYMBOL_for_stmt = 35,                  /* for_stmt  */
+  YYSYMBOL_return_stmt = 36,               /* return_stmt  */
+  YYSYMBOL_expr = 37,                      /* expr  */
+  YYSYMBOL_expr_list = 38                  /* expr_list  */
 };
 typedef enum yysymbol_kind_t yysymbol_kind_t;
 
 
 
+/* Unqualified %code blocks.  */
+#line 23 "parser.y"
+
+    #include "source.h"
+
+    /* A rule spans from the start of its first symbol to the end of its
+       last; an empty rule is an empty span where it was reduced. */
+    #define YYLLOC_DEFAULT(Cur, Rhs, N)                                     \
+        do {                                                                \
+            if (N) {                                                        \
+                (Cur).offset = YYRHSLOC(Rhs, 1).offset;                     \
+                (Cur).length = YYRHSLOC(Rhs, N).offset +                    \
+                               YYRHSLOC(Rhs, N).length - (Cur).offset;      \
+            } else {                                                        \
+                (Cur).offset = YYRHSLOC(Rhs, 0).offset +                    \
+                               YYRHSLOC(Rhs, 0).length;                     \
+                (Cur).length = 0;                                           \
+            }                                                               \
+        } while (0)
+
+    /* Tokens come from the array parse.c scanned ahead, if it did, and
+       otherwise from the scanner it picked. The grammar stops at the end
+       token, so it never reads past the array. */
+    int parser_lex(YYSTYPE* lvalp, YYLTYPE* llocp, Parser* parser);
+
+    static inline int next_token(Parser* parser, YYSTYPE* lvalp, YYLTYPE* llocp) {
+        if (!parser->next) return parser_lex(lvalp, llocp, parser);
+
+        const Token* token = parser->next++;
+        memcpy(lvalp, &token->value, sizeof(token->value));
+        *llocp = token->loc;
+        return token->kind;
+    }
+    #define yylex(lvalp, llocp, scanner) next_token(parser, lvalp, llocp)
+
+    void yyerror(YYLTYPE* loc, yyscan_t scanner, Parser* parser, const char* s) {
+        (void)scanner;
+        if (!parser->source) {
+            fprintf(stderr, "%s: Parse error at byte %u: %s\n", parser->name, loc->offset, s);
+            return;
+        }
+
+        /* The scanner has only marked text past the error, so the part
+           before it can still be indexed. */
+        LineIndex lines;
+        unsigned line, column;
+        line_index_build(&lines, parser->source, loc->offset);
+        line_index_lookup(&lines, loc->offset, &line, &column);
+        line_index_free(&lines);
+        fprintf(stderr, "%s:%u:%u: Parse error: %s\n", parser->name, line, column, s);
+    }
+
+    /* A shared (hash-consed) node keeps the span of its first use. */
+    static ASTNode* at(ASTNode* node, SrcSpan loc) {
+        if (!AST_IS_CONSED(node) || !node->loc.length) node->loc = loc;
+        return node;
+    }
+
+#line 207 "parser.tab.c"
 
 #ifdef short
 # undef short
@@ -409,13 +465,15 @@ void free (void *); /* INFRINGES ON USER NAME SPACE */
 
 #if (! defined yyoverflow \
      && (! defined __cplusplus \
-         || (defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
+         || (defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL \
+             && defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
 
 /* A type that is properly aligned for any stack member.  */
 union yyalloc
 {
   yy_state_t yyss_alloc;
   YYSTYPE yyvs_alloc;
+  YYLTYPE yyls_alloc;
 };
 
 /* The size of the maximum gap between one aligned stack and the next.  */
@@ -424,8 +482,9 @@ union yyalloc
 /* The size of an array large to enough to hold all stacks, each with
    N elements.  */
 # define YYSTACK_BYTES(N) \
-     ((N) * (YYSIZEOF (yy_state_t) + YYSIZEOF (YYSTYPE)) \
-      + YYSTACK_GAP_MAXIMUM)
+     ((N) * (YYSIZEOF (yy_state_t) + YYSIZEOF (YYSTYPE) \
+             + YYSIZEOF (YYLTYPE)) \
+      + 2 * YYSTACK_GAP_MAXIMUM)
 
 # define YYCOPY_NEEDED 1
 
@@ -468,18 +527,18 @@ union yyalloc
 #endif /* !YYCOPY_NEEDED */
 
 /* YYFINAL -- State number of the termination state.  */
-#define YYFINAL  5
+#define YYFINAL  6
 /* YYLAST -- Last index in YYTABLE.  */
 #define YYLAST   109
 
 /* YYNTOKENS -- Number of terminals.  */
 #define YYNTOKENS  24
 /* YYNNTS -- Number of nonterminals.  */
-#define YYNNTS  14
+#define YYNNTS  15
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  35
+#define YYNRULES  37
 /* YYNSTATES -- Number of states.  */
-#define YYNSTATES  71
+#define YYNSTATES  73
 
 /* YYMAXUTOK -- Last valid token kind.  */
 #define YYMAXUTOK   278
@@ -528,12 +587,12 @@ static const yytype_int8 yytranslate[] =
 
 #if YYDEBUG
 /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
-static const yytype_int8 yyrline[] =
+static const yytype_uint8 yyrline[] =
 {
-       0,    42,    42,    46,    51,    55,    56,    60,    64,    65,
-      66,    67,    68,    72,    74,    78,    83,    84,    85,    86,
-      90,    95,    99,   100,   101,   102,   103,   104,   105,   106,
-     107,   108,   109,   110,   115,   116
+       0,   107,   107,   113,   114,   118,   123,   127,   128,   132,
+     136,   137,   138,   139,   140,   144,   146,   150,   155,   156,
+     157,   158,   162,   167,   171,   172,   173,   174,   175,   176,
+     177,   178,   179,   180,   181,   182,   187,   188
 };
 #endif
 
@@ -552,9 +611,10 @@ static const char *const yytname[] =
   "\"end of file\"", "error", "\"invalid token\"", "NUMBER", "IDENTIFIER",
   "STRING", "KW_INT", "KW_IF", "KW_FOR", "KW_RETURN", "LPAREN", "RPAREN",
   "LBRACE", "RBRACE", "SEMICOLON", "ASSIGN", "COMMA", "PLUS", "MINUS",
-  "MUL", "DIV", "LT", "INCR", "DECR", "$accept", "program", "function",
-  "type", "stmt_list", "compound_stmt", "stmt", "decl_stmt", "if_stmt",
-  "for_init", "for_stmt", "return_stmt", "expr", "expr_list", YY_NULLPTR
+  "MUL", "DIV", "LT", "INCR", "DECR", "$accept", "program",
+  "function_list", "function", "type", "stmt_list", "compound_stmt",
+  "stmt", "decl_stmt", "if_stmt", "for_init", "for_stmt", "return_stmt",
+  "expr", "expr_list", YY_NULLPTR
 };
 
 static const char *
@@ -564,7 +624,7 @@ yysymbol_name (yysymbol_kind_t yysymbol)
 }
 #endif
 
-#define YYPACT_NINF (-54)
+#define YYPACT_NINF (-56)
 
 #define yypact_value_is_default(Yyn) \
   ((Yyn) == YYPACT_NINF)
@@ -578,14 +638,14 @@ yysymbol_name (yysymbol_kind_t yysymbol)
    STATE-NUM.  */
 static const yytype_int8 yypact[] =
 {
-       1,   -54,    42,   -54,    44,   -54,    36,    33,    37,    96,
-     -54,   -54,    -8,   -54,    64,    59,    66,    32,    25,   -54,
-     -54,   -54,   -54,   -54,    53,     6,   -54,   -54,   -11,    32,
-      20,    61,   -54,   -54,   -54,    32,    32,    32,    32,    32,
-     -54,    40,   -10,   -54,    32,    34,    73,    70,    40,   -54,
-      21,    21,   -54,   -54,    89,   -54,    32,    69,    37,    78,
-      32,    40,   -54,   -54,    32,    77,    40,    32,    45,    37,
-     -54
+       1,   -56,    42,     1,   -56,    44,   -56,   -56,    36,    33,
+      37,    96,   -56,   -56,    -8,   -56,    64,    59,    66,    32,
+      25,   -56,   -56,   -56,   -56,   -56,    53,     6,   -56,   -56,
+     -11,    32,    20,    61,   -56,   -56,   -56,    32,    32,    32,
+      32,    32,   -56,    40,   -10,   -56,    32,    34,    73,    70,
+      40,   -56,    21,    21,   -56,   -56,    89,   -56,    32,    69,
+      37,    78,    32,    40,   -56,   -56,    32,    77,    40,    32,
+      45,    37,   -56
 };
 
 /* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
@@ -593,28 +653,28 @@ static const yytype_int8 yypact[] =
    means the default is an error.  */
 static const yytype_int8 yydefact[] =
 {
-       0,     4,     0,     2,     0,     1,     0,     0,     0,     0,
-       3,    29,    31,    30,     0,     0,     0,     0,     0,     5,
-       8,    10,    11,    12,     0,     0,    27,    28,     0,     0,
-      19,     0,     7,     6,     9,     0,     0,     0,     0,     0,
-      32,    34,     0,    14,     0,     0,     0,     0,    18,    21,
-      22,    23,    24,    25,    26,    33,     0,     0,     0,    17,
-       0,    35,    13,    15,     0,     0,    16,     0,     0,     0,
-      20
+       0,     6,     0,     2,     3,     0,     1,     4,     0,     0,
+       0,     0,     5,    31,    33,    32,     0,     0,     0,     0,
+       0,     7,    10,    12,    13,    14,     0,     0,    29,    30,
+       0,     0,    21,     0,     9,     8,    11,     0,     0,     0,
+       0,     0,    34,    36,     0,    16,     0,     0,     0,     0,
+      20,    23,    24,    25,    26,    27,    28,    35,     0,     0,
+       0,    19,     0,    37,    15,    17,     0,     0,    18,     0,
+       0,     0,    22
 };
 
 /* YYPGOTO[NTERM-NUM].  */
 static const yytype_int8 yypgoto[] =
 {
-     -54,   -54,   -54,   -54,   -54,   -53,    67,   -54,   -54,   -54,
-     -54,   -54,   -17,   -54
+     -56,   -56,   -56,    82,   -56,   -56,   -55,    72,   -56,   -56,
+     -56,   -56,   -56,   -19,   -56
 };
 
 /* YYDEFGOTO[NTERM-NUM].  */
 static const yytype_int8 yydefgoto[] =
 {
-       0,     2,     3,     4,    18,    10,    19,    20,    21,    47,
-      22,    23,    24,    42
+       0,     2,     3,     4,     5,    20,    12,    21,    22,    23,
+      49,    24,    25,    26,    44
 };
 
 /* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
@@ -622,31 +682,31 @@ static const yytype_int8 yydefgoto[] =
    number is the opposite.  If YYTABLE_NINF, syntax error.  */
 static const yytype_int8 yytable[] =
 {
-      31,    55,    25,    43,    44,    63,    56,     1,    41,    11,
-      12,    13,    45,    48,    26,    27,    70,    40,    50,    51,
-      52,    53,    54,    11,    12,    13,    46,    57,    11,    12,
-      13,    14,    15,    16,    17,    11,    12,    13,    32,    61,
-      37,    38,     5,    65,     8,    58,     7,    66,     6,     9,
-      68,    35,    36,    37,    38,    39,    69,    35,    36,    37,
-      38,    39,    35,    36,    37,    38,    39,    34,    28,    29,
-      35,    36,    37,    38,    39,    49,    30,    59,    35,    36,
-      37,    38,    39,    62,    60,    33,    35,    36,    37,    38,
-      39,    67,     0,    64,    35,    36,    37,    38,    39,    11,
-      12,    13,    14,    15,    16,    17,    35,    36,    37,    38
+      33,    57,    27,    45,    46,    65,    58,     1,    43,    13,
+      14,    15,    47,    50,    28,    29,    72,    42,    52,    53,
+      54,    55,    56,    13,    14,    15,    48,    59,    13,    14,
+      15,    16,    17,    18,    19,    13,    14,    15,    34,    63,
+      39,    40,     6,    67,    10,    60,     9,    68,     8,    11,
+      70,    37,    38,    39,    40,    41,    71,    37,    38,    39,
+      40,    41,    37,    38,    39,    40,    41,    36,    30,    31,
+      37,    38,    39,    40,    41,    51,    32,    61,    37,    38,
+      39,    40,    41,    64,    62,     7,    37,    38,    39,    40,
+      41,    69,    35,    66,    37,    38,    39,    40,    41,    13,
+      14,    15,    16,    17,    18,    19,    37,    38,    39,    40
 };
 
 static const yytype_int8 yycheck[] =
 {
-      17,    11,    10,    14,    15,    58,    16,     6,    25,     3,
-       4,     5,    29,    30,    22,    23,    69,    11,    35,    36,
-      37,    38,    39,     3,     4,     5,     6,    44,     3,     4,
-       5,     6,     7,     8,     9,     3,     4,     5,    13,    56,
-      19,    20,     0,    60,    11,    11,    10,    64,     4,    12,
-      67,    17,    18,    19,    20,    21,    11,    17,    18,    19,
+      19,    11,    10,    14,    15,    60,    16,     6,    27,     3,
+       4,     5,    31,    32,    22,    23,    71,    11,    37,    38,
+      39,    40,    41,     3,     4,     5,     6,    46,     3,     4,
+       5,     6,     7,     8,     9,     3,     4,     5,    13,    58,
+      19,    20,     0,    62,    11,    11,    10,    66,     4,    12,
+      69,    17,    18,    19,    20,    21,    11,    17,    18,    19,
       20,    21,    17,    18,    19,    20,    21,    14,     4,    10,
       17,    18,    19,    20,    21,    14,    10,     4,    17,    18,
-      19,    20,    21,    14,    14,    18,    17,    18,    19,    20,
-      21,    14,    -1,    15,    17,    18,    19,    20,    21,     3,
+      19,    20,    21,    14,    14,     3,    17,    18,    19,    20,
+      21,    14,    20,    15,    17,    18,    19,    20,    21,     3,
        4,     5,     6,     7,     8,     9,    17,    18,    19,    20
 };
 
@@ -654,32 +714,32 @@ static const yytype_int8 yycheck[] =
    state STATE-NUM.  */
 static const yytype_int8 yystos[] =
 {
-       0,     6,    25,    26,    27,     0,     4,    10,    11,    12,
-      29,     3,     4,     5,     6,     7,     8,     9,    28,    30,
-      31,    32,    34,    35,    36,    10,    22,    23,     4,    10,
-      10,    36,    13,    30,    14,    17,    18,    19,    20,    21,
-      11,    36,    37,    14,    15,    36,     6,    33,    36,    14,
-      36,    36,    36,    36,    36,    11,    16,    36,    11,     4,
-      14,    36,    14,    29,    15,    36,    36,    14,    36,    11,
-      29
+       0,     6,    25,    26,    27,    28,     0,    27,     4,    10,
+      11,    12,    30,     3,     4,     5,     6,     7,     8,     9,
+      29,    31,    32,    33,    35,    36,    37,    10,    22,    23,
+       4,    10,    10,    37,    13,    31,    14,    17,    18,    19,
+      20,    21,    11,    37,    38,    14,    15,    37,     6,    34,
+      37,    14,    37,    37,    37,    37,    37,    11,    16,    37,
+      11,     4,    14,    37,    14,    30,    15,    37,    37,    14,
+      37,    11,    30
 };
 
 /* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
 static const yytype_int8 yyr1[] =
 {
-       0,    24,    25,    26,    27,    28,    28,    29,    30,    30,
-      30,    30,    30,    31,    31,    32,    33,    33,    33,    33,
-      34,    35,    36,    36,    36,    36,    36,    36,    36,    36,
-      36,    36,    36,    36,    37,    37
+       0,    24,    25,    26,    26,    27,    28,    29,    29,    30,
+      31,    31,    31,    31,    31,    32,    32,    33,    34,    34,
+      34,    34,    35,    36,    37,    37,    37,    37,    37,    37,
+      37,    37,    37,    37,    37,    37,    38,    38
 };
 
 /* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
 static const yytype_int8 yyr2[] =
 {
-       0,     2,     1,     5,     1,     1,     2,     3,     1,     2,
-       1,     1,     1,     5,     3,     5,     4,     2,     1,     0,
-       9,     3,     3,     3,     3,     3,     3,     2,     2,     1,
-       1,     1,     3,     4,     1,     3
+       0,     2,     1,     1,     2,     5,     1,     1,     2,     3,
+       1,     2,     1,     1,     1,     5,     3,     5,     4,     2,
+       1,     0,     9,     3,     3,     3,     3,     3,     3,     2,
+       2,     1,     1,     1,     3,     4,     1,     3
 };
 
 
@@ -708,7 +768,7 @@ enum { YYENOMEM = -2 };
       }                                                           \
     else                                                          \
       {                                                           \
-        yyerror (YY_("syntax error: cannot back up")); \
+        yyerror (&yylloc, scanner, parser, YY_("syntax error: cannot back up")); \
         YYERROR;                                                  \
       }                                                           \
   while (0)
@@ -717,6 +777,32 @@ enum { YYENOMEM = -2 };
    Use YYerror or YYUNDEF. */
 #define YYERRCODE YYUNDEF
 
+/* YYLLOC_DEFAULT -- Set CURRENT to span from RHS[1] to RHS[N].
+   If N is 0, then set CURRENT to the empty location which ends
+   the previous symbol: RHS[0] (always defined).  */
+
+#ifndef YYLLOC_DEFAULT
+# define YYLLOC_DEFAULT(Current, Rhs, N)                                \
+    do                                                                  \
+      if (N)                                                            \
+        {                                                               \
+          (Current).first_line   = YYRHSLOC (Rhs, 1).first_line;        \
+          (Current).first_column = YYRHSLOC (Rhs, 1).first_column;      \
+          (Current).last_line    = YYRHSLOC (Rhs, N).last_line;         \
+          (Current).last_column  = YYRHSLOC (Rhs, N).last_column;       \
+        }                                                               \
+      else                                                              \
+        {                                                               \
+          (Current).first_line   = (Current).last_line   =              \
+            YYRHSLOC (Rhs, 0).last_line;                                \
+          (Current).first_column = (Current).last_column =              \
+            YYRHSLOC (Rhs, 0).last_column;                              \
+        }                                                               \
+    while (0)
+#endif
+
+#define YYRHSLOC(Rhs, K) ((Rhs)[K])
+
 
 /* Enable debugging if requested.  */
 #if YYDEBUG
@@ -733,6 +819,63 @@ do {                                            \
 } while (0)
 
 
+/* YYLOCATION_PRINT -- Print the location on the stream.
+   This macro was not mandated originally: define only if we know
+   we won't break user code: when these are the locations we know.  */
+
+# ifndef YYLOCATION_PRINT
+
+#  if defined YY_LOCATION_PRINT
+
+   /* Temporary convenience wrapper in case some people defined the
+      undocumented and private YY_LOCATION_PRINT macros.  */
+#   define YYLOCATION_PRINT(File, Loc)  YY_LOCATION_PRINT(File, *(Loc))
+
+#  elif defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL
+
+/* Print *YYLOCP on YYO.  Private, do not rely on its existence. */
+
+YY_ATTRIBUTE_UNUSED
+static int
+yy_location_print_ (FILE *yyo, YYLTYPE const * const yylocp)
+{
+  int res = 0;
+  int end_col = 0 != yylocp->last_column ? yylocp->last_column - 1 : 0;
+  if (0 <= yylocp->first_line)
+    {
+      res += YYFPRINTF (yyo, "%d", yylocp->first_line);
+      if (0 <= yylocp->first_column)
+        res += YYFPRINTF (yyo, ".%d", yylocp->first_column);
+    }
+  if (0 <= yylocp->last_line)
+    {
+      if (yylocp->first_line < yylocp->last_line)
+        {
+          res += YYFPRINTF (yyo, "-%d", yylocp->last_line);
+          if (0 <= end_col)
+            res += YYFPRINTF (yyo, ".%d", end_col);
+        }
+      else if (0 <= end_col && yylocp->first_column < end_col)
+        res += YYFPRINTF (yyo, "-%d", end_col);
+    }
+  return res;
+}
+
+#   define YYLOCATION_PRINT  yy_location_print_
+
+    /* Temporary convenience wrapper in case some people defined the
+       undocumented and private YY_LOCATION_PRINT macros.  */
+#   define YY_LOCATION_PRINT(File, Loc)  YYLOCATION_PRINT(File, &(Loc))
+
+#  else
+
+#   define YYLOCATION_PRINT(File, Loc) ((void) 0)
+    /* Temporary convenience wrapper in case some people defined the
+       undocumented and private YY_LOCATION_PRINT macros.  */
+#   define YY_LOCATION_PRINT  YYLOCATION_PRINT
+
+#  endif
+# endif /* !defined YYLOCATION_PRINT */
 
 
 # define YY_SYMBOL_PRINT(Title, Kind, Value, Location)                    \
@@ -741,7 +884,7 @@ do {                                                                      \
     {                                                                     \
       YYFPRINTF (stderr, "%s ", Title);                                   \
       yy_symbol_print (stderr,                                            \
-                  Kind, Value); \
+                  Kind, Value, Location, scanner, parser); \
       YYFPRINTF (stderr, "\n");                                           \
     }                                                                     \
 } while (0)
@@ -753,10 +896,13 @@ do {                                                                      \
 
 static void
 yy_symbol_value_print (FILE *yyo,
-                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep)
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp, yyscan_t scanner, Parser* parser)
 {
   FILE *yyoutput = yyo;
   YY_USE (yyoutput);
+  YY_USE (yylocationp);
+  YY_USE (scanner);
+  YY_USE (parser);
   if (!yyvaluep)
     return;
   YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
@@ -771,12 +917,14 @@ yy_symbol_value_print (FILE *yyo,
 
 static void
 yy_symbol_print (FILE *yyo,
-                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep)
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp, yyscan_t scanner, Parser* parser)
 {
   YYFPRINTF (yyo, "%s %s (",
              yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
 
-  yy_symbol_value_print (yyo, yykind, yyvaluep);
+  YYLOCATION_PRINT (yyo, yylocationp);
+  YYFPRINTF (yyo, ": ");
+  yy_symbol_value_print (yyo, yykind, yyvaluep, yylocationp, scanner, parser);
   YYFPRINTF (yyo, ")");
 }
 
@@ -809,8 +957,8 @@ do {                                                            \
 `------------------------------------------------*/
 
 static void
-yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
-                 int yyrule)
+yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp, YYLTYPE *yylsp,
+                 int yyrule, yyscan_t scanner, Parser* parser)
 {
   int yylno = yyrline[yyrule];
   int yynrhs = yyr2[yyrule];
@@ -823,7 +971,8 @@ yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
       YYFPRINTF (stderr, "   $%d = ", yyi + 1);
       yy_symbol_print (stderr,
                        YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
-                       &yyvsp[(yyi + 1) - (yynrhs)]);
+                       &yyvsp[(yyi + 1) - (yynrhs)],
+                       &(yylsp[(yyi + 1) - (yynrhs)]), scanner, parser);
       YYFPRINTF (stderr, "\n");
     }
 }
@@ -831,7 +980,7 @@ yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
 # define YY_REDUCE_PRINT(Rule)          \
 do {                                    \
   if (yydebug)                          \
-    yy_reduce_print (yyssp, yyvsp, Rule); \
+    yy_reduce_print (yyssp, yyvsp, yylsp, Rule, scanner, parser); \
 } while (0)
 
 /* Nonzero means print parse trace.  It is left uninitialized so that
@@ -872,9 +1021,12 @@ int yydebug;
 
 static void
 yydestruct (const char *yymsg,
-            yysymbol_kind_t yykind, YYSTYPE *yyvaluep)
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep, YYLTYPE *yylocationp, yyscan_t scanner, Parser* parser)
 {
   YY_USE (yyvaluep);
+  YY_USE (yylocationp);
+  YY_USE (scanner);
+  YY_USE (parser);
   if (!yymsg)
     yymsg = "Deleting";
   YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
@@ -885,13 +1037,6 @@ yydestruct (const char *yymsg,
 }
 
 
-/* Lookahead token kind.  */
-int yychar;
-
-/* The semantic value of the lookahead symbol.  */
-YYSTYPE yylval;
-/* Number of syntax errors so far.  */
-int yynerrs;
 
 
 
@@ -901,8 +1046,29 @@ int yynerrs;
 `----------*/
 
 int
-yyparse (void)
+yyparse (yyscan_t scanner, Parser* parser)
 {
+/* Lookahead token kind.  */
+int yychar;
+
+
+/* The semantic value of the lookahead symbol.  */
+/* Default value used for initialization, for pacifying older GCCs
+   or non-GCC compilers.  */
+YY_INITIAL_VALUE (static YYSTYPE yyval_default;)
+YYSTYPE yylval YY_INITIAL_VALUE (= yyval_default);
+
+/* Location data for the lookahead symbol.  */
+static YYLTYPE yyloc_default
+# if defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL
+  = { 1, 1, 1, 1 }
+# endif
+;
+YYLTYPE yylloc = yyloc_default;
+
+    /* Number of syntax errors so far.  */
+    int yynerrs = 0;
+
     yy_state_fast_t yystate = 0;
     /* Number of tokens to shift before error messages enabled.  */
     int yyerrstatus = 0;
@@ -923,6 +1089,11 @@ yyparse (void)
     YYSTYPE *yyvs = yyvsa;
     YYSTYPE *yyvsp = yyvs;
 
+    /* The location stack: array, bottom, top.  */
+    YYLTYPE yylsa[YYINITDEPTH];
+    YYLTYPE *yyls = yylsa;
+    YYLTYPE *yylsp = yyls;
+
   int yyn;
   /* The return value of yyparse.  */
   int yyresult;
@@ -931,10 +1102,14 @@ yyparse (void)
   /* The variables used to return semantic value and location from the
      action routines.  */
   YYSTYPE yyval;
+  YYLTYPE yyloc;
 
+  /* The locations where the error started and ended.  */
+  YYLTYPE yyerror_range[3];
 
 
-#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
+
+#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N), yylsp -= (N))
 
   /* The number of symbols on the RHS of the reduced rule.
      Keep to zero when no symbol should be popped.  */
@@ -944,6 +1119,7 @@ yyparse (void)
 
   yychar = YYEMPTY; /* Cause a token to be read.  */
 
+  yylsp[0] = yylloc;
   goto yysetstate;
 
 
@@ -982,6 +1158,7 @@ yysetstate:
            memory.  */
         yy_state_t *yyss1 = yyss;
         YYSTYPE *yyvs1 = yyvs;
+        YYLTYPE *yyls1 = yyls;
 
         /* Each stack pointer address is followed by the size of the
            data in use in that stack, in bytes.  This used to be a
@@ -990,9 +1167,11 @@ yysetstate:
         yyoverflow (YY_("memory exhausted"),
                     &yyss1, yysize * YYSIZEOF (*yyssp),
                     &yyvs1, yysize * YYSIZEOF (*yyvsp),
+                    &yyls1, yysize * YYSIZEOF (*yylsp),
                     &yystacksize);
         yyss = yyss1;
         yyvs = yyvs1;
+        yyls = yyls1;
       }
 # else /* defined YYSTACK_RELOCATE */
       /* Extend the stack our own way.  */
@@ -1011,6 +1190,7 @@ yysetstate:
           YYNOMEM;
         YYSTACK_RELOCATE (yyss_alloc, yyss);
         YYSTACK_RELOCATE (yyvs_alloc, yyvs);
+        YYSTACK_RELOCATE (yyls_alloc, yyls);
 #  undef YYSTACK_RELOCATE
         if (yyss1 != yyssa)
           YYSTACK_FREE (yyss1);
@@ -1019,6 +1199,7 @@ yysetstate:
 
       yyssp = yyss + yysize - 1;
       yyvsp = yyvs + yysize - 1;
+      yylsp = yyls + yysize - 1;
 
       YY_IGNORE_USELESS_CAST_BEGIN
       YYDPRINTF ((stderr, "Stack size increased to %ld\n",
@@ -1055,7 +1236,7 @@ yybackup:
   if (yychar == YYEMPTY)
     {
       YYDPRINTF ((stderr, "Reading a token\n"));
-      yychar = yylex ();
+      yychar = yylex (&yylval, &yylloc, scanner);
     }
 
   if (yychar <= YYEOF)
@@ -1072,6 +1253,7 @@ yybackup:
          loop in error recovery. */
       yychar = YYUNDEF;
       yytoken = YYSYMBOL_YYerror;
+      yyerror_range[1] = yylloc;
       goto yyerrlab1;
     }
   else
@@ -1105,6 +1287,7 @@ yybackup:
   YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
   *++yyvsp = yylval;
   YY_IGNORE_MAYBE_UNINITIALIZED_END
+  *++yylsp = yylloc;
 
   /* Discard the shifted token.  */
   yychar = YYEMPTY;
@@ -1138,216 +1321,224 @@ yyreduce:
      GCC warning that YYVAL may be used uninitialized.  */
   yyval = yyvsp[1-yylen];
 
-
+  /* Default location. */
+  YYLLOC_DEFAULT (yyloc, (yylsp - yylen), yylen);
+  yyerror_range[1] = yyloc;
   YY_REDUCE_PRINT (yyn);
   switch (yyn)
     {
-  case 2: /* program: function  */
-#line 42 "parser.y"
-                                        { ast_root = (yyvsp[0].node); }
-#line 1149 "parser.tab.c"
+  case 3: /* function_list: function  */
+#line 113 "parser.y"
+                                        { (yyval.node) = parser->root = (yyvsp[0].node); }
+#line 1334 "parser.tab.c"
     break;
 
-  case 3: /* function: type IDENTIFIER LPAREN RPAREN compound_stmt  */
-#line 47 "parser.y"
-                                        { (yyval.node) = make_function_node((yyvsp[-3].str), (yyvsp[0].node)); }
-#line 1155 "parser.tab.c"
+  case 4: /* function_list: function_list function  */
+#line 114 "parser.y"
+                                        { (yyval.node) = add_sibling((yyvsp[-1].node), (yyvsp[0].node)); }
+#line 1340 "parser.tab.c"
     break;
 
-  case 4: /* type: KW_INT  */
-#line 51 "parser.y"
-                                        { (yyval.node) = make_type_node("int"); }
-#line 1161 "parser.tab.c"
+  case 5: /* function: type IDENTIFIER LPAREN RPAREN compound_stmt  */
+#line 119 "parser.y"
+                                        { (yyval.node) = at(make_function_node((yyvsp[-3].str), (yyvsp[0].node)), (yyloc)); ast_cons_flush(); }
+#line 1346 "parser.tab.c"
     break;
 
-  case 5: /* stmt_list: stmt  */
-#line 55 "parser.y"
-                                        { (yyval.node) = (yyvsp[0].node); }
-#line 1167 "parser.tab.c"
+  case 6: /* type: KW_INT  */
+#line 123 "parser.y"
+                                        { (yyval.node) = at(make_type_node("int"), (yyloc)); }
+#line 1352 "parser.tab.c"
     break;
 
-  case 6: /* stmt_list: stmt_list stmt  */
-#line 56 "parser.y"
-                                        { (yyval.node) = make_seq_node((yyvsp[-1].node), (yyvsp[0].node)); }
-#line 1173 "parser.tab.c"
+  case 7: /* stmt_list: stmt  */
+#line 127 "parser.y"
+                                        { (yyval.node) = at(make_block_node((yyvsp[0].node)), (yyloc)); }
+#line 1358 "parser.tab.c"
     break;
 
-  case 7: /* compound_stmt: LBRACE stmt_list RBRACE  */
-#line 60 "parser.y"
-                                        { (yyval.node) = (yyvsp[-1].node); }
-#line 1179 "parser.tab.c"
+  case 8: /* stmt_list: stmt_list stmt  */
+#line 128 "parser.y"
+                                        { (yyval.node) = at(list_append((yyvsp[-1].node), (yyvsp[0].node)), (yyloc)); }
+#line 1364 "parser.tab.c"
     break;
 
-  case 8: /* stmt: decl_stmt  */
-#line 64 "parser.y"
+  case 9: /* compound_stmt: LBRACE stmt_list RBRACE  */
+#line 132 "parser.y"
+                                        { (yyval.node) = at((yyvsp[-1].node), (yyloc)); }
+#line 1370 "parser.tab.c"
+    break;
+
+  case 10: /* stmt: decl_stmt  */
+#line 136 "parser.y"
                                         { (yyval.node) = (yyvsp[0].node); }
-#line 1185 "parser.tab.c"
+#line 1376 "parser.tab.c"
     break;
 
-  case 9: /* stmt: expr SEMICOLON  */
-#line 65 "parser.y"
+  case 11: /* stmt: expr SEMICOLON  */
+#line 137 "parser.y"
                                         { (yyval.node) = (yyvsp[-1].node); }
-#line 1191 "parser.tab.c"
+#line 1382 "parser.tab.c"
     break;
 
-  case 10: /* stmt: if_stmt  */
-#line 66 "parser.y"
+  case 12: /* stmt: if_stmt  */
+#line 138 "parser.y"
                                         { (yyval.node) = (yyvsp[0].node); }
-#line 1197 "parser.tab.c"
+#line 1388 "parser.tab.c"
     break;
 
-  case 11: /* stmt: for_stmt  */
-#line 67 "parser.y"
+  case 13: /* stmt: for_stmt  */
+#line 139 "parser.y"
                                         { (yyval.node) = (yyvsp[0].node); }
-#line 1203 "parser.tab.c"
+#line 1394 "parser.tab.c"
     break;
 
-  case 12: /* stmt: return_stmt  */
-#line 68 "parser.y"
+  case 14: /* stmt: return_stmt  */
+#line 140 "parser.y"
                                         { (yyval.node) = (yyvsp[0].node); }
-#line 1209 "parser.tab.c"
+#line 1400 "parser.tab.c"
     break;
 
-  case 13: /* decl_stmt: KW_INT IDENTIFIER ASSIGN expr SEMICOLON  */
-#line 73 "parser.y"
-                                        { (yyval.node) = make_decl_node((yyvsp[-3].str), (yyvsp[-1].node)); }
-#line 1215 "parser.tab.c"
+  case 15: /* decl_stmt: KW_INT IDENTIFIER ASSIGN expr SEMICOLON  */
+#line 145 "parser.y"
+                                        { (yyval.node) = at(make_decl_node((yyvsp[-3].str), (yyvsp[-1].node)), (yyloc)); }
+#line 1406 "parser.tab.c"
     break;
 
-  case 14: /* decl_stmt: KW_INT IDENTIFIER SEMICOLON  */
-#line 74 "parser.y"
-                                        { (yyval.node) = make_decl_node((yyvsp[-1].str), NULL); }
-#line 1221 "parser.tab.c"
+  case 16: /* decl_stmt: KW_INT IDENTIFIER SEMICOLON  */
+#line 146 "parser.y"
+                                        { (yyval.node) = at(make_decl_node((yyvsp[-1].str), NULL), (yyloc)); }
+#line 1412 "parser.tab.c"
     break;
 
-  case 15: /* if_stmt: KW_IF LPAREN expr RPAREN compound_stmt  */
-#line 79 "parser.y"
-                                        { (yyval.node) = make_if_node((yyvsp[-2].node), (yyvsp[0].node)); }
-#line 1227 "parser.tab.c"
+  case 17: /* if_stmt: KW_IF LPAREN expr RPAREN compound_stmt  */
+#line 151 "parser.y"
+                                        { (yyval.node) = at(make_if_node((yyvsp[-2].node), (yyvsp[0].node)), (yyloc)); }
+#line 1418 "parser.tab.c"
     break;
 
-  case 16: /* for_init: KW_INT IDENTIFIER ASSIGN expr  */
-#line 83 "parser.y"
-                                        { (yyval.node) = make_decl_node((yyvsp[-2].str), (yyvsp[0].node)); }
-#line 1233 "parser.tab.c"
+  case 18: /* for_init: KW_INT IDENTIFIER ASSIGN expr  */
+#line 155 "parser.y"
+                                        { (yyval.node) = at(make_decl_node((yyvsp[-2].str), (yyvsp[0].node)), (yyloc)); }
+#line 1424 "parser.tab.c"
     break;
 
-  case 17: /* for_init: KW_INT IDENTIFIER  */
-#line 84 "parser.y"
-                                        { (yyval.node) = make_decl_node((yyvsp[0].str), NULL); }
-#line 1239 "parser.tab.c"
+  case 19: /* for_init: KW_INT IDENTIFIER  */
+#line 156 "parser.y"
+                                        { (yyval.node) = at(make_decl_node((yyvsp[0].str), NULL), (yyloc)); }
+#line 1430 "parser.tab.c"
     break;
 
-  case 18: /* for_init: expr  */
-#line 85 "parser.y"
+  case 20: /* for_init: expr  */
+#line 157 "parser.y"
                                         { (yyval.node) = (yyvsp[0].node); }
-#line 1245 "parser.tab.c"
+#line 1436 "parser.tab.c"
     break;
 
-  case 19: /* for_init: %empty  */
-#line 86 "parser.y"
+  case 21: /* for_init: %empty  */
+#line 158 "parser.y"
                                         { (yyval.node) = NULL; }
-#line 1251 "parser.tab.c"
+#line 1442 "parser.tab.c"
     break;
 
-  case 20: /* for_stmt: KW_FOR LPAREN for_init SEMICOLON expr SEMICOLON expr RPAREN compound_stmt  */
-#line 91 "parser.y"
-                                        { (yyval.node) = make_for_node((yyvsp[-6].node), (yyvsp[-4].node), (yyvsp[-2].node), (yyvsp[0].node)); }
-#line 1257 "parser.tab.c"
+  case 22: /* for_stmt: KW_FOR LPAREN for_init SEMICOLON expr SEMICOLON expr RPAREN compound_stmt  */
+#line 163 "parser.y"
+                                        { (yyval.node) = at(make_for_node((yyvsp[-6].node), (yyvsp[-4].node), (yyvsp[-2].node), (yyvsp[0].node)), (yyloc)); }
+#line 1448 "parser.tab.c"
     break;
 
-  case 21: /* return_stmt: KW_RETURN expr SEMICOLON  */
-#line 95 "parser.y"
-                                        { (yyval.node) = make_return_node((yyvsp[-1].node)); }
-#line 1263 "parser.tab.c"
+  case 23: /* return_stmt: KW_RETURN expr SEMICOLON  */
+#line 167 "parser.y"
+                                        { (yyval.node) = at(make_return_node((yyvsp[-1].node)), (yyloc)); }
+#line 1454 "parser.tab.c"
     break;
 
-  case 22: /* expr: expr PLUS expr  */
-#line 99 "parser.y"
-                                        { (yyval.node) = make_binop_node('+', (yyvsp[-2].node), (yyvsp[0].node)); }
-#line 1269 "parser.tab.c"
+  case 24: /* expr: expr PLUS expr  */
+#line 171 "parser.y"
+                                        { (yyval.node) = at(make_binop_node(OP_ADD, (yyvsp[-2].node), (yyvsp[0].node)), (yyloc)); }
+#line 1460 "parser.tab.c"
     break;
 
-  case 23: /* expr: expr MINUS expr  */
-#line 100 "parser.y"
-                                        { (yyval.node) = make_binop_node('-', (yyvsp[-2].node), (yyvsp[0].node)); }
-#line 1275 "parser.tab.c"
+  case 25: /* expr: expr MINUS expr  */
+#line 172 "parser.y"
+                                        { (yyval.node) = at(make_binop_node(OP_SUB, (yyvsp[-2].node), (yyvsp[0].node)), (yyloc)); }
+#line 1466 "parser.tab.c"
     break;
 
-  case 24: /* expr: expr MUL expr  */
-#line 101 "parser.y"
-                                        { (yyval.node) = make_binop_node('*', (yyvsp[-2].node), (yyvsp[0].node)); }
-#line 1281 "parser.tab.c"
+  case 26: /* expr: expr MUL expr  */
+#line 173 "parser.y"
+                                        { (yyval.node) = at(make_binop_node(OP_MUL, (yyvsp[-2].node), (yyvsp[0].node)), (yyloc)); }
+#line 1472 "parser.tab.c"
     break;
 
-  case 25: /* expr: expr DIV expr  */
-#line 102 "parser.y"
-                                        { (yyval.node) = make_binop_node('/', (yyvsp[-2].node), (yyvsp[0].node)); }
-#line 1287 "parser.tab.c"
+  case 27: /* expr: expr DIV expr  */
+#line 174 "parser.y"
+                                        { (yyval.node) = at(make_binop_node(OP_DIV, (yyvsp[-2].node), (yyvsp[0].node)), (yyloc)); }
+#line 1478 "parser.tab.c"
     break;
 
-  case 26: /* expr: expr LT expr  */
-#line 103 "parser.y"
-                                        { (yyval.node) = make_binop_node('<', (yyvsp[-2].node), (yyvsp[0].node)); }
-#line 1293 "parser.tab.c"
+  case 28: /* expr: expr LT expr  */
+#line 175 "parser.y"
+                                        { (yyval.node) = at(make_binop_node(OP_LT, (yyvsp[-2].node), (yyvsp[0].node)), (yyloc)); }
+#line 1484 "parser.tab.c"
     break;
 
-  case 27: /* expr: IDENTIFIER INCR  */
-#line 104 "parser.y"
-                                        { (yyval.node) = make_unary_node("++", make_var_node((yyvsp[-1].str))); }
-#line 1299 "parser.tab.c"
+  case 29: /* expr: IDENTIFIER INCR  */
+#line 176 "parser.y"
+                                        { (yyval.node) = at(make_unary_node(OP_INC, at(make_var_node((yyvsp[-1].str)), (yylsp[-1]))), (yyloc)); }
+#line 1490 "parser.tab.c"
     break;
 
-  case 28: /* expr: IDENTIFIER DECR  */
-#line 105 "parser.y"
-                                        { (yyval.node) = make_unary_node("--", make_var_node((yyvsp[-1].str))); }
-#line 1305 "parser.tab.c"
+  case 30: /* expr: IDENTIFIER DECR  */
+#line 177 "parser.y"
+                                        { (yyval.node) = at(make_unary_node(OP_DEC, at(make_var_node((yyvsp[-1].str)), (yylsp[-1]))), (yyloc)); }
+#line 1496 "parser.tab.c"
     break;
 
-  case 29: /* expr: NUMBER  */
-#line 106 "parser.y"
-                                        { (yyval.node) = make_int_node((yyvsp[0].ival)); }
-#line 1311 "parser.tab.c"
+  case 31: /* expr: NUMBER  */
+#line 178 "parser.y"
+                                        { (yyval.node) = at(make_int_node((yyvsp[0].ival)), (yyloc)); }
+#line 1502 "parser.tab.c"
     break;
 
-  case 30: /* expr: STRING  */
-#line 107 "parser.y"
-                                        { (yyval.node) = make_string_node((yyvsp[0].str)); }
-#line 1317 "parser.tab.c"
+  case 32: /* expr: STRING  */
+#line 179 "parser.y"
+                                        { (yyval.node) = at(make_string_node((yyvsp[0].str)), (yyloc)); }
+#line 1508 "parser.tab.c"
     break;
 
-  case 31: /* expr: IDENTIFIER  */
-#line 108 "parser.y"
-                                        { (yyval.node) = make_var_node((yyvsp[0].str)); }
-#line 1323 "parser.tab.c"
+  case 33: /* expr: IDENTIFIER  */
+#line 180 "parser.y"
+                                        { (yyval.node) = at(make_var_node((yyvsp[0].str)), (yyloc)); }
+#line 1514 "parser.tab.c"
     break;
 
-  case 32: /* expr: IDENTIFIER LPAREN RPAREN  */
-#line 109 "parser.y"
-                                        { (yyval.node) = make_func_call_node((yyvsp[-2].str), NULL); }
-#line 1329 "parser.tab.c"
+  case 34: /* expr: IDENTIFIER LPAREN RPAREN  */
+#line 181 "parser.y"
+                                        { (yyval.node) = at(make_func_call_node((yyvsp[-2].str), NULL), (yyloc)); }
+#line 1520 "parser.tab.c"
     break;
 
-  case 33: /* expr: IDENTIFIER LPAREN expr_list RPAREN  */
-#line 111 "parser.y"
-                                        { (yyval.node) = make_func_call_node((yyvsp[-3].str), (yyvsp[-1].node)); }
-#line 1335 "parser.tab.c"
+  case 35: /* expr: IDENTIFIER LPAREN expr_list RPAREN  */
+#line 183 "parser.y"
+                                        { (yyval.node) = at(make_func_call_node((yyvsp[-3].str), (yyvsp[-1].node)), (yyloc)); }
+#line 1526 "parser.tab.c"
     break;
 
-  case 34: /* expr_list: expr  */
-#line 115 "parser.y"
-                                        { (yyval.node) = make_expr_list_node((yyvsp[0].node), NULL); }
-#line 1341 "parser.tab.c"
+  case 36: /* expr_list: expr  */
+#line 187 "parser.y"
+                                        { (yyval.node) = at(make_expr_list_node((yyvsp[0].node)), (yyloc)); }
+#line 1532 "parser.tab.c"
     break;
 
-  case 35: /* expr_list: expr_list COMMA expr  */
-#line 116 "parser.y"
-                                        { (yyval.node) = make_expr_list_node((yyvsp[0].node), (yyvsp[-2].node)); }
-#line 1347 "parser.tab.c"
+  case 37: /* expr_list: expr_list COMMA expr  */
+#line 188 "parser.y"
+                                        { (yyval.node) = at(list_append((yyvsp[-2].node), (yyvsp[0].node)), (yyloc)); }
+#line 1538 "parser.tab.c"
     break;
 
 
-#line 1351 "parser.tab.c"
+#line 1542 "parser.tab.c"
 
       default: break;
     }
@@ -1368,6 +1559,7 @@ yyreduce:
   yylen = 0;
 
   *++yyvsp = yyval;
+  *++yylsp = yyloc;
 
   /* Now 'shift' the result of the reduction.  Determine what state
      that goes to, based on the state we popped back to and the rule
@@ -1394,9 +1586,10 @@ yyerrlab:
   if (!yyerrstatus)
     {
       ++yynerrs;
-      yyerror (YY_("syntax error"));
+      yyerror (&yylloc, scanner, parser, YY_("syntax error"));
     }
 
+  yyerror_range[1] = yylloc;
   if (yyerrstatus == 3)
     {
       /* If just tried and failed to reuse lookahead token after an
@@ -1411,7 +1604,7 @@ yyerrlab:
       else
         {
           yydestruct ("Error: discarding",
-                      yytoken, &yylval);
+                      yytoken, &yylval, &yylloc, scanner, parser);
           yychar = YYEMPTY;
         }
     }
@@ -1465,9 +1658,9 @@ yyerrlab1:
       if (yyssp == yyss)
         YYABORT;
 
-
+      yyerror_range[1] = *yylsp;
       yydestruct ("Error: popping",
-                  YY_ACCESSING_SYMBOL (yystate), yyvsp);
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp, yylsp, scanner, parser);
       YYPOPSTACK (1);
       yystate = *yyssp;
       YY_STACK_PRINT (yyss, yyssp);
@@ -1477,6 +1670,9 @@ yyerrlab1:
   *++yyvsp = yylval;
   YY_IGNORE_MAYBE_UNINITIALIZED_END
 
+  yyerror_range[2] = yylloc;
+  ++yylsp;
+  YYLLOC_DEFAULT (*yylsp, yyerror_range, 2);
 
   /* Shift the error token.  */
   YY_SYMBOL_PRINT ("Shifting", YY_ACCESSING_SYMBOL (yyn), yyvsp, yylsp);
@@ -1505,7 +1701,7 @@ yyabortlab:
 | yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
 `-----------------------------------------------------------*/
 yyexhaustedlab:
-  yyerror (YY_("memory exhausted"));
+  yyerror (&yylloc, scanner, parser, YY_("memory exhausted"));
   yyresult = 2;
   goto yyreturnlab;
 
@@ -1520,7 +1716,7 @@ yyreturnlab:
          user semantic actions for why this is necessary.  */
       yytoken = YYTRANSLATE (yychar);
       yydestruct ("Cleanup: discarding lookahead",
-                  yytoken, &yylval);
+                  yytoken, &yylval, &yylloc, scanner, parser);
     }
   /* Do not reclaim the symbols of the rule whose action triggered
      this YYABORT or YYACCEPT.  */
@@ -1529,7 +1725,7 @@ yyreturnlab:
   while (yyssp != yyss)
     {
       yydestruct ("Cleanup: popping",
-                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp);
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp, yylsp, scanner, parser);
       YYPOPSTACK (1);
     }
 #ifndef yyoverflow
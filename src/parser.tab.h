@@ -48,8 +48,14 @@ extern int yydebug;
 #line 1 "parser.y"
 
     #include "ast.h"
+    #include "parse.h"
 
-#line 53 "parser.tab.h"
+    #ifndef YY_TYPEDEF_YY_SCANNER_T
+    #define YY_TYPEDEF_YY_SCANNER_T
+    typedef void* yyscan_t;
+    #endif
+
+#line 59 "parser.tab.h"
 
 /* Token kinds.  */
 #ifndef YYTOKENTYPE
@@ -89,13 +95,13 @@ extern int yydebug;
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
 union YYSTYPE
 {
-#line 15 "parser.y"
+#line 80 "parser.y"
 
     int ival;
-    char* str;
+    const char* str;
     ASTNode* node;
 
-#line 99 "parser.tab.h"
+#line 105 "parser.tab.h"
 
 };
 typedef union YYSTYPE YYSTYPE;
@@ -103,11 +109,13 @@ typedef union YYSTYPE YYSTYPE;
 # define YYSTYPE_IS_DECLARED 1
 #endif
 
+/* Location type.  */
+typedef SrcSpan YYLTYPE;
+
 
-extern YYSTYPE yylval;
 
 
-int yyparse (void);
+int yyparse (yyscan_t scanner, Parser* parser);
 
 
 #endif /* !YY_YY_PARSER_TAB_H_INCLUDED  */
@@ -1,20 +1,85 @@
 %code requires {
     #include "ast.h"
+    #include "parse.h"
+
+    #ifndef YY_TYPEDEF_YY_SCANNER_T
+    #define YY_TYPEDEF_YY_SCANNER_T
+    typedef void* yyscan_t;
+    #endif
 }
 
 %{
 #include <stdio.h>
+#include <string.h>
 #include "ast.h"
-
-extern int yylex();
-void yyerror(const char* s) { fprintf(stderr, "Parse error: %s\n", s); }
-
-ASTNode* ast_root;
 %}
 
+%define api.pure full
+%define api.location.type {SrcSpan}
+%locations
+%param { yyscan_t scanner }
+%parse-param { Parser* parser }
+
+%code {
+    #include "source.h"
+
+    /* A rule spans from the start of its first symbol to the end of its
+       last; an empty rule is an empty span where it was reduced. */
+    #define YYLLOC_DEFAULT(Cur, Rhs, N)                                     \
+        do {                                                                \
+            if (N) {                                                        \
+                (Cur).offset = YYRHSLOC(Rhs, 1).offset;                     \
+                (Cur).length = YYRHSLOC(Rhs, N).offset +                    \
+                               YYRHSLOC(Rhs, N).length - (Cur).offset;      \
+            } else {                                                        \
+                (Cur).offset = YYRHSLOC(Rhs, 0).offset +                    \
+                               YYRHSLOC(Rhs, 0).length;                     \
+                (Cur).length = 0;                                           \
+            }                                                               \
+        } while (0)
+
+    /* Tokens come from the array parse.c scanned ahead, if it did, and
+       otherwise from the scanner it picked. The grammar stops at the end
+       token, so it never reads past the array. */
+    int parser_lex(YYSTYPE* lvalp, YYLTYPE* llocp, Parser* parser);
+
+    static inline int next_token(Parser* parser, YYSTYPE* lvalp, YYLTYPE* llocp) {
+        if (!parser->next) return parser_lex(lvalp, llocp, parser);
+
+        const Token* token = parser->next++;
+        memcpy(lvalp, &token->value, sizeof(token->value));
+        *llocp = token->loc;
+        return token->kind;
+    }
+    #define yylex(lvalp, llocp, scanner) next_token(parser, lvalp, llocp)
+
+    void yyerror(YYLTYPE* loc, yyscan_t scanner, Parser* parser, const char* s) {
+        (void)scanner;
+        if (!parser->source) {
+            fprintf(stderr, "%s: Parse error at byte %u: %s\n", parser->name, loc->offset, s);
+            return;
+        }
+
+        /* The scanner has only marked text past the error, so the part
+           before it can still be indexed. */
+        LineIndex lines;
+        unsigned line, column;
+        line_index_build(&lines, parser->source, loc->offset);
+        line_index_lookup(&lines, loc->offset, &line, &column);
+        line_index_free(&lines);
+        fprintf(stderr, "%s:%u:%u: Parse error: %s\n", parser->name, line, column, s);
+    }
+
+    /* A shared (hash-consed) node keeps the span of its first use. */
+    static ASTNode* at(ASTNode* node, SrcSpan loc) {
+        if (!AST_IS_CONSED(node) || !node->loc.length) node->loc = loc;
+        return node;
+    }
+}
+
 %union {
     int ival;
-    char* str;
+    const char* str;
     ASTNode* node;
 }
 
@@ -28,7 +93,7 @@ ASTNode* ast_root;
 %token INCR DECR
 
 %type <node> stmt stmt_list compound_stmt expr expr_list decl_stmt
-               if_stmt for_stmt return_stmt function type program for_init
+               if_stmt for_stmt return_stmt function function_list type for_init
 
 %left LT
 %left PLUS MINUS
@@ -39,25 +104,32 @@ ASTNode* ast_root;
 %%
 
 program:
-      function                          { ast_root = $1; }
+      function_list
+    ;
+
+/* Functions are chained through `next`; the value is the last one, so
+   appending does not walk the chain. */
+function_list:
+      function                          { $$ = parser->root = $1; }
+    | function_list function            { $$ = add_sibling($1, $2); }
     ;
 
 function:
       type IDENTIFIER LPAREN RPAREN compound_stmt
-                                        { $$ = make_function_node($2, $5); }
+                                        { $$ = at(make_function_node($2, $5), @$); ast_cons_flush(); }
     ;
 
 type:
-      KW_INT                            { $$ = make_type_node("int"); }
+      KW_INT                            { $$ = at(make_type_node("int"), @$); }
     ;
 
 stmt_list:
-      stmt                              { $$ = $1; }
-    | stmt_list stmt                    { $$ = make_seq_node($1, $2); }
+      stmt                              { $$ = at(make_block_node($1), @$); }
+    | stmt_list stmt                    { $$ = at(list_append($1, $2), @$); }
     ;
 
 compound_stmt:
-      LBRACE stmt_list RBRACE           { $$ = $2; }
+      LBRACE stmt_list RBRACE           { $$ = at($2, @$); }
     ;
 
 stmt:
@@ -70,48 +142,48 @@ stmt:
 
 decl_stmt:
       KW_INT IDENTIFIER ASSIGN expr SEMICOLON
-                                        { $$ = make_decl_node($2, $4); }
-    | KW_INT IDENTIFIER SEMICOLON       { $$ = make_decl_node($2, NULL); }
+                                        { $$ = at(make_decl_node($2, $4), @$); }
+    | KW_INT IDENTIFIER SEMICOLON       { $$ = at(make_decl_node($2, NULL), @$); }
     ;
 
 if_stmt:
       KW_IF LPAREN expr RPAREN compound_stmt
-                                        { $$ = make_if_node($3, $5); }
+                                        { $$ = at(make_if_node($3, $5), @$); }
     ;
 
 for_init:
-      KW_INT IDENTIFIER ASSIGN expr     { $$ = make_decl_node($2, $4); }
-    | KW_INT IDENTIFIER                 { $$ = make_decl_node($2, NULL); }
+      KW_INT IDENTIFIER ASSIGN expr     { $$ = at(make_decl_node($2, $4), @$); }
+    | KW_INT IDENTIFIER                 { $$ = at(make_decl_node($2, NULL), @$); }
     | expr                              { $$ = $1; }
     | /* empty */                       { $$ = NULL; }
     ;
 
 for_stmt:
       KW_FOR LPAREN for_init SEMICOLON expr SEMICOLON expr RPAREN compound_stmt
-                                        { $$ = make_for_node($3, $5, $7, $9); }
+                                        { $$ = at(make_for_node($3, $5, $7, $9), @$); }
     ;
 
 return_stmt:
-      KW_RETURN expr SEMICOLON          { $$ = make_return_node($2); }
+      KW_RETURN expr SEMICOLON          { $$ = at(make_return_node($2), @$); }
     ;
 
 expr:
-      expr PLUS expr                    { $$ = make_binop_node('+', $1, $3); }
-    | expr MINUS expr                   { $$ = make_binop_node('-', $1, $3); }
-    | expr MUL expr                     { $$ = make_binop_node('*', $1, $3); }
-    | expr DIV expr                     { $$ = make_binop_node('/', $1, $3); }
-    | expr LT expr                      { $$ = make_binop_node('<', $1, $3); }
-    | IDENTIFIER INCR                   { $$ = make_unary_node("++", make_var_node($1)); }
-    | IDENTIFIER DECR                   { $$ = make_unary_node("--", make_var_node($1)); }
-    | NUMBER                            { $$ = make_int_node($1); }
-    | STRING                            { $$ = make_string_node($1); }
-    | IDENTIFIER                        { $$ = make_var_node($1); }
-    | IDENTIFIER LPAREN RPAREN          { $$ = make_func_call_node($1, NULL); }
+      expr PLUS expr                    { $$ = at(make_binop_node(OP_ADD, $1, $3), @$); }
+    | expr MINUS expr                   { $$ = at(make_binop_node(OP_SUB, $1, $3), @$); }
+    | expr MUL expr                     { $$ = at(make_binop_node(OP_MUL, $1, $3), @$); }
+    | expr DIV expr                     { $$ = at(make_binop_node(OP_DIV, $1, $3), @$); }
+    | expr LT expr                      { $$ = at(make_binop_node(OP_LT, $1, $3), @$); }
+    | IDENTIFIER INCR                   { $$ = at(make_unary_node(OP_INC, at(make_var_node($1), @1)), @$); }
+    | IDENTIFIER DECR                   { $$ = at(make_unary_node(OP_DEC, at(make_var_node($1), @1)), @$); }
+    | NUMBER                            { $$ = at(make_int_node($1), @$); }
+    | STRING                            { $$ = at(make_string_node($1), @$); }
+    | IDENTIFIER                        { $$ = at(make_var_node($1), @$); }
+    | IDENTIFIER LPAREN RPAREN          { $$ = at(make_func_call_node($1, NULL), @$); }
     | IDENTIFIER LPAREN expr_list RPAREN
-                                        { $$ = make_func_call_node($1, $3); }
+                                        { $$ = at(make_func_call_node($1, $3), @$); }
     ;
 
 expr_list:
-      expr                              { $$ = make_expr_list_node($1, NULL); }
-    | expr_list COMMA expr              { $$ = make_expr_list_node($3, $1); }
+      expr                              { $$ = at(make_expr_list_node($1), @$); }
+    | expr_list COMMA expr              { $$ = at(list_append($1, $3), @$); }
     ;
@@ -0,0 +1,260 @@
+#include <stdlib.h>
+#include <string.h>
+#include "simdlex.h"
+#include "parser.tab.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SIMDLEX_X86 1
+#endif
+
+
+typedef enum {
+    CLASS_SPACE,          /* [ \t\r\n] */
+    CLASS_IDENT,          /* [a-zA-Z0-9_] */
+    CLASS_DIGIT           /* [0-9] */
+} CharClass;
+
+
+static inline int in_class(unsigned char c, CharClass cls) {
+    switch (cls) {
+        case CLASS_SPACE:
+            return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+        case CLASS_IDENT:
+            return (unsigned)((c | 0x20) - 'a') < 26 || (unsigned)(c - '0') < 10 || c == '_';
+        default:
+            return (unsigned)(c - '0') < 10;
+    }
+}
+
+
+static size_t span_scalar(const char* p, const char* end, CharClass cls) {
+    const char* start = p;
+    while (p < end && in_class((unsigned char)*p, cls)) {
+        p++;
+    }
+    return (size_t)(p - start);
+}
+
+
+#ifdef SIMDLEX_X86
+
+/* Bytes in [lo, hi], as unsigned: max(v - lo, hi - lo) == hi - lo. */
+static inline __m128i sse_in_range(__m128i v, char lo, char hi) {
+    __m128i width = _mm_set1_epi8((char)(hi - lo));
+    return _mm_cmpeq_epi8(_mm_max_epu8(_mm_sub_epi8(v, _mm_set1_epi8(lo)), width), width);
+}
+
+
+static inline unsigned sse_class_mask(__m128i v, CharClass cls) {
+    __m128i m;
+
+    switch (cls) {
+        case CLASS_SPACE:
+            m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                          _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                             _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+                                          _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+            break;
+        case CLASS_IDENT:
+            /* Setting bit 5 folds upper case onto lower case and maps no
+               other byte into a-z. */
+            m = _mm_or_si128(_mm_or_si128(sse_in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z'),
+                                          sse_in_range(v, '0', '9')),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+            break;
+        default:
+            m = sse_in_range(v, '0', '9');
+            break;
+    }
+    return (unsigned)_mm_movemask_epi8(m);
+}
+
+
+static size_t span_sse2(const char* p, const char* end, CharClass cls) {
+    const char* start = p;
+
+    for (; end - p >= 16; p += 16) {
+        unsigned outside = ~sse_class_mask(_mm_loadu_si128((const __m128i*)p), cls) & 0xFFFF;
+        if (outside) return (size_t)(p - start) + (size_t)__builtin_ctz(outside);
+    }
+    return (size_t)(p - start) + span_scalar(p, end, cls);
+}
+
+
+__attribute__((target("avx2")))
+static inline __m256i avx_in_range(__m256i v, char lo, char hi) {
+    __m256i width = _mm256_set1_epi8((char)(hi - lo));
+    return _mm256_cmpeq_epi8(_mm256_max_epu8(_mm256_sub_epi8(v, _mm256_set1_epi8(lo)), width), width);
+}
+
+
+__attribute__((target("avx2")))
+static inline unsigned avx_class_mask(__m256i v, CharClass cls) {
+    __m256i m;
+
+    switch (cls) {
+        case CLASS_SPACE:
+            m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')),
+                                                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+            break;
+        case CLASS_IDENT:
+            m = _mm256_or_si256(_mm256_or_si256(avx_in_range(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z'),
+                                                avx_in_range(v, '0', '9')),
+                                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+            break;
+        default:
+            m = avx_in_range(v, '0', '9');
+            break;
+    }
+    return (unsigned)_mm256_movemask_epi8(m);
+}
+
+
+__attribute__((target("avx2")))
+static size_t span_avx2(const char* p, const char* end, CharClass cls) {
+    const char* start = p;
+
+    for (; end - p >= 32; p += 32) {
+        unsigned outside = ~avx_class_mask(_mm256_loadu_si256((const __m256i*)p), cls);
+        if (outside) return (size_t)(p - start) + (size_t)__builtin_ctz(outside);
+    }
+    return (size_t)(p - start) + span_sse2(p, end, cls);
+}
+
+#endif
+
+
+/* Length of the run of `cls` bytes at p, stopping at end. Most runs are
+   a byte or two, so those are checked before any vector load; the NUL
+   after the input is in no class, so p[1] may always be read. */
+static inline size_t span(const SimdLexer* lexer, const char* p, const char* end, CharClass cls) {
+    if (p >= end || !in_class((unsigned char)p[0], cls)) return 0;
+    if (!in_class((unsigned char)p[1], cls)) return 1;
+    if (!in_class((unsigned char)p[2], cls)) return 2;
+#ifdef SIMDLEX_X86
+    return lexer->avx2 ? span_avx2(p, end, cls) : span_sse2(p, end, cls);
+#else
+    (void)lexer;
+    return span_scalar(p, end, cls);
+#endif
+}
+
+
+const char* simd_lex_isa(void) {
+#ifdef SIMDLEX_X86
+    return __builtin_cpu_supports("avx2") ? "avx2" : "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+
+void simd_lex_init(SimdLexer* lexer, const char* data, size_t size) {
+    lexer->data = data;
+    lexer->size = size;
+    lexer->pos = 0;
+#ifdef SIMDLEX_X86
+    lexer->avx2 = __builtin_cpu_supports("avx2");
+#else
+    lexer->avx2 = 0;
+#endif
+}
+
+
+static int keyword(const char* text, size_t len) {
+    switch (len) {
+        case 2:
+            return memcmp(text, "if", 2) == 0 ? KW_IF : 0;
+        case 3:
+            if (memcmp(text, "int", 3) == 0) return KW_INT;
+            return memcmp(text, "for", 3) == 0 ? KW_FOR : 0;
+        case 6:
+            return memcmp(text, "return", 6) == 0 ? KW_RETURN : 0;
+        default:
+            return 0;
+    }
+}
+
+
+/* Mirrors the rules of lexer.l, including what its YY_USER_ACTION does
+   to the span: whitespace runs set it too, and the end of input leaves
+   it alone. */
+int simd_lex(SimdLexer* lexer, YYSTYPE* lvalp, SrcSpan* llocp) {
+    const char* end = lexer->data + lexer->size;
+    const char* p = lexer->data + lexer->pos;
+
+    size_t blank = span(lexer, p, end, CLASS_SPACE);
+    if (blank) {
+        llocp->offset = (uint32_t)lexer->pos;
+        llocp->length = (uint32_t)blank;
+        p += blank;
+    }
+    if (p >= end) {
+        lexer->pos = lexer->size;
+        return 0;
+    }
+
+    const char* start = p;
+    unsigned char c = (unsigned char)*p;
+    size_t len = 1;
+    int token;
+
+    if ((unsigned)((c | 0x20) - 'a') < 26 || c == '_') {
+        len += span(lexer, p + 1, end, CLASS_IDENT);
+        token = keyword(start, len);
+        if (!token) {
+            lvalp->str = ast_intern(start, len);
+            token = IDENTIFIER;
+        }
+    } else if ((unsigned)(c - '0') < 10) {
+        len = span(lexer, p, end, CLASS_DIGIT);
+        lvalp->ival = atoi(start);
+        token = NUMBER;
+    } else {
+        switch (c) {
+            case '"': {
+                /* Without a closing quote the rule does not match and the
+                   quote is returned as a character. */
+                const char* close = (const char*)memchr(p + 1, '"', (size_t)(end - p - 1));
+                if (close) {
+                    len = (size_t)(close - start) + 1;
+                    lvalp->str = ast_intern(start, len);
+                    token = STRING;
+                } else {
+                    token = '"';
+                }
+                break;
+            }
+            case '=': token = ASSIGN; break;
+            case ';': token = SEMICOLON; break;
+            case ',': token = COMMA; break;
+            case '(': token = LPAREN; break;
+            case ')': token = RPAREN; break;
+            case '{': token = LBRACE; break;
+            case '}': token = RBRACE; break;
+            case '*': token = MUL; break;
+            case '/': token = DIV; break;
+            case '<': token = LT; break;
+            case '+':
+                token = p[1] == '+' ? INCR : PLUS;
+                len = token == INCR ? 2 : 1;
+                break;
+            case '-':
+                token = p[1] == '-' ? DECR : MINUS;
+                len = token == DECR ? 2 : 1;
+                break;
+            default:
+                /* flex returns yytext[0], a plain char. */
+                token = (char)c;
+                break;
+        }
+    }
+
+    llocp->offset = (uint32_t)(start - lexer->data);
+    llocp->length = (uint32_t)len;
+    lexer->pos = (size_t)(start - lexer->data) + len;
+    return token;
+}
@@ -0,0 +1,34 @@
+#ifndef SIMDLEX_H
+#define SIMDLEX_H
+
+#include <stddef.h>
+#include "ast.h"
+
+
+union YYSTYPE;
+
+
+/* Hand-written scanner for the language of lexer.l. It returns the same
+   tokens, values and spans as the flex scanner, but skips whitespace and
+   measures identifiers and numbers 16 (SSE2) or 32 (AVX2) bytes at a
+   time. It scans a mapped buffer in place and never writes to it. */
+typedef struct {
+    const char* data;
+    size_t size;
+    size_t pos;
+    int avx2;             /* chosen by simd_lex_init from the running CPU */
+} SimdLexer;
+
+
+/* "avx2", "sse2" or "scalar": the widest routine simd_lex will use here. */
+const char* simd_lex_isa(void);
+
+/* data[size] must be readable (SourceBuffer's NUL padding). */
+void simd_lex_init(SimdLexer* lexer, const char* data, size_t size);
+
+/* Same contract as the flex yylex: returns the token kind, or 0 at the
+   end, and sets *lvalp and *llocp. Identifiers and strings are interned
+   into the calling thread's AST arena. */
+int simd_lex(SimdLexer* lexer, union YYSTYPE* lvalp, SrcSpan* llocp);
+
+#endif
@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "source.h"
+
+
+/* Maps the file over an anonymous region a little larger than it: the
+   tail of the last file page reads as zeros, and if the file ends on a
+   page boundary the NULs come from the anonymous page after it. */
+static int map_file(SourceBuffer* src, int fd, size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t length = (size + 2 + page - 1) / page * page;
+
+    char* base = (char*)mmap(NULL, length, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return 0;
+
+    if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, length);
+        return 0;
+    }
+    madvise(base, length, MADV_SEQUENTIAL);
+
+    src->data = base;
+    src->size = size;
+    src->mapped = length;
+    return 1;
+}
+
+
+/* Fallback for pipes and anything else mmap refuses. */
+static int read_file(SourceBuffer* src, int fd) {
+    size_t capacity = 64 * 1024;
+    size_t size = 0;
+    char* data = (char*)malloc(capacity);
+
+    for (;;) {
+        if (!data) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        if (capacity - size <= 2) {
+            capacity *= 2;
+            data = (char*)realloc(data, capacity);
+            continue;
+        }
+
+        ssize_t n = read(fd, data + size, capacity - size - 2);
+        if (n < 0) {
+            free(data);
+            return 0;
+        }
+        if (n == 0) break;
+        size += (size_t)n;
+    }
+
+    data[size] = '\0';
+    data[size + 1] = '\0';
+    src->data = data;
+    src->size = size;
+    src->mapped = 0;
+    return 1;
+}
+
+
+int source_open(SourceBuffer* src, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    int ok = 0;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        ok = map_file(src, fd, (size_t)st.st_size);
+    }
+    if (!ok) {
+        ok = read_file(src, fd);
+    }
+
+    close(fd);
+    return ok;
+}
+
+
+void source_close(SourceBuffer* src) {
+    if (src->mapped) {
+        munmap(src->data, src->mapped);
+    } else {
+        free(src->data);
+    }
+    src->data = NULL;
+    src->size = 0;
+    src->mapped = 0;
+}
+
+
+void line_index_build(LineIndex* index, const char* text, size_t size) {
+    size_t capacity = 1024;
+    index->starts = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    if (!index->starts) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    index->starts[0] = 0;
+    index->count = 1;
+
+    const char* end = text + size;
+    for (const char* p = text; (p = memchr(p, '\n', (size_t)(end - p))) != NULL;) {
+        p++;
+        if (index->count == capacity) {
+            capacity *= 2;
+            index->starts = (uint32_t*)realloc(index->starts, capacity * sizeof(uint32_t));
+            if (!index->starts) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(1);
+            }
+        }
+        index->starts[index->count++] = (uint32_t)(p - text);
+    }
+}
+
+
+void line_index_free(LineIndex* index) {
+    free(index->starts);
+    index->starts = NULL;
+    index->count = 0;
+}
+
+
+void line_index_lookup(const LineIndex* index, uint32_t offset, unsigned* line, unsigned* column) {
+    size_t lo = 0;
+    size_t hi = index->count;
+
+    /* Last line starting at or before offset; starts[0] is always 0. */
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->starts[mid] <= offset) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    *line = (unsigned)lo + 1;
+    *column = offset - index->starts[lo] + 1;
+}
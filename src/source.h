@@ -0,0 +1,40 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* A whole source file in memory, followed by the two NUL bytes flex wants
+   at the end of a buffer it scans in place. Regular files are mapped
+   privately, so the scanner's temporary NULs never reach the file. */
+typedef struct {
+    char* data;
+    size_t size;          /* file bytes, not counting the NULs */
+    size_t mapped;        /* length of the mapping, or 0 if data is malloc'd */
+} SourceBuffer;
+
+
+/* Returns 0 and sets errno if the file cannot be read. */
+int source_open(SourceBuffer* src, const char* path);
+
+void source_close(SourceBuffer* src);
+
+
+/* Offsets at which each line of a text starts, for turning SrcSpan
+   offsets into line and column numbers. */
+typedef struct {
+    uint32_t* starts;
+    size_t count;
+} LineIndex;
+
+
+/* Indexes text[0..size). */
+void line_index_build(LineIndex* index, const char* text, size_t size);
+
+void line_index_free(LineIndex* index);
+
+/* 1-based line and column of `offset`, by binary search. */
+void line_index_lookup(const LineIndex* index, uint32_t offset, unsigned* line, unsigned* column);
+
+#endif
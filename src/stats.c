@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <string.h>
+#include "stats.h"
+#include "optimize.h"
+
+
+static const char* const phase_names[PHASE_COUNT] = {
+    "read",
+    "scan",
+    "parse",
+    "constant-folding",
+    "dead-code",
+    "common-subexpr",
+    "print",
+    "dot"
+};
+
+
+void phase_mark(PhaseMark* mark) {
+    ast_alloc_stats(&mark->alloc);
+    mark->ms = pass_time_ms();
+}
+
+
+void phase_add(PhaseStats* phase, const PhaseMark* mark, size_t bytes_written) {
+    double now = pass_time_ms();
+    AstAllocStats alloc;
+
+    ast_alloc_stats(&alloc);
+    phase->ms += now - mark->ms;
+    phase->bytes_written += bytes_written;
+
+    /* A reset in between (a failed parse) restarts the counters. */
+    if (alloc.bytes >= mark->alloc.bytes) {
+        phase->bytes_allocated += alloc.bytes - mark->alloc.bytes;
+    }
+    for (int i = 0; i < NODE_TYPE_COUNT; i++) {
+        if (alloc.created[i] >= mark->alloc.created[i]) {
+            phase->created[i] += alloc.created[i] - mark->alloc.created[i];
+        }
+    }
+}
+
+
+void phase_stats_merge(PhaseStats* total, const PhaseStats* part) {
+    total->ms += part->ms;
+    total->bytes_allocated += part->bytes_allocated;
+    total->bytes_written += part->bytes_written;
+    for (int i = 0; i < NODE_TYPE_COUNT; i++) {
+        total->created[i] += part->created[i];
+    }
+}
+
+
+void run_stats_init(RunStats* stats) {
+    memset(&stats->total, 0, sizeof(stats->total));
+    stats->wall_ms = 0;
+    pthread_mutex_init(&stats->lock, NULL);
+}
+
+
+void run_stats_free(RunStats* stats) {
+    pthread_mutex_destroy(&stats->lock);
+}
+
+
+void run_stats_merge(RunStats* stats, const FileStats* file) {
+    pthread_mutex_lock(&stats->lock);
+    stats->total.files += file->files;
+    stats->total.bytes_read += file->bytes_read;
+    stats->total.tokens += file->tokens;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        phase_stats_merge(&stats->total.phases[p], &file->phases[p]);
+    }
+    pthread_mutex_unlock(&stats->lock);
+}
+
+
+static size_t phase_nodes(const PhaseStats* phase) {
+    size_t nodes = 0;
+    for (int i = 0; i < NODE_TYPE_COUNT; i++) {
+        nodes += phase->created[i];
+    }
+    return nodes;
+}
+
+
+static void print_table(const RunStats* stats, FILE* output) {
+    const FileStats* total = &stats->total;
+    PhaseStats sum;
+    int shown[PHASE_COUNT];
+    int columns = 0;
+
+    fprintf(output, "Stats: %zu files, %zu bytes read, %zu tokens, %.3f ms wall\n",
+            total->files, total->bytes_read, total->tokens, stats->wall_ms);
+    fprintf(output, "%-18s %12s %12s %14s %14s\n",
+            "phase", "ms", "nodes", "allocated", "written");
+
+    memset(&sum, 0, sizeof(sum));
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        const PhaseStats* phase = &total->phases[p];
+        fprintf(output, "%-18s %12.3f %12zu %14zu %14zu\n", phase_names[p], phase->ms,
+                phase_nodes(phase), phase->bytes_allocated, phase->bytes_written);
+        phase_stats_merge(&sum, phase);
+        if (phase_nodes(phase)) shown[columns++] = p;
+    }
+    fprintf(output, "%-18s %12.3f %12zu %14zu %14zu\n", "total", sum.ms,
+            phase_nodes(&sum), sum.bytes_allocated, sum.bytes_written);
+
+    if (!columns) return;
+
+    /* Nodes created by type, one column per phase that created any. */
+    fprintf(output, "\n%-18s", "nodes by type");
+    for (int c = 0; c < columns; c++) {
+        fprintf(output, " %16s", phase_names[shown[c]]);
+    }
+    fputc('\n', output);
+    for (int i = 0; i < NODE_TYPE_COUNT; i++) {
+        fprintf(output, "%-18s", get_node_type_str((NodeType)i));
+        for (int c = 0; c < columns; c++) {
+            fprintf(output, " %16zu", total->phases[shown[c]].created[i]);
+        }
+        fputc('\n', output);
+    }
+}
+
+
+static void print_json(const RunStats* stats, FILE* output) {
+    const FileStats* total = &stats->total;
+
+    fprintf(output, "{\"files\": %zu, \"bytes_read\": %zu, \"tokens\": %zu, \"wall_ms\": %.3f, \"phases\": [",
+            total->files, total->bytes_read, total->tokens, stats->wall_ms);
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        const PhaseStats* phase = &total->phases[p];
+
+        fprintf(output, "%s\n  {\"name\": \"%s\", \"ms\": %.3f, \"nodes\": %zu, "
+                "\"bytes_allocated\": %zu, \"bytes_written\": %zu, \"nodes_by_type\": {",
+                p ? "," : "", phase_names[p], phase->ms, phase_nodes(phase),
+                phase->bytes_allocated, phase->bytes_written);
+        for (int i = 0; i < NODE_TYPE_COUNT; i++) {
+            fprintf(output, "%s\"%s\": %zu", i ? ", " : "",
+                    get_node_type_str((NodeType)i), phase->created[i]);
+        }
+        fputs("}}", output);
+    }
+    fputs("\n]}\n", output);
+}
+
+
+void run_stats_print(const RunStats* stats, FILE* output, int json) {
+    if (json) {
+        print_json(stats, output);
+    } else {
+        print_table(stats, output);
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include "ast.h"
+
+
+typedef enum {
+    PHASE_READ,           /* opening the input, or loading a saved tree */
+    PHASE_SCAN,           /* tokenizing a mapped input */
+    PHASE_PARSE,          /* parsing its tokens; with --stdio, scanning too */
+    PHASE_FOLD,
+    PHASE_DCE,
+    PHASE_CSE,
+    PHASE_PRINT,
+    PHASE_DOT,
+    PHASE_COUNT
+} RunPhase;
+
+
+typedef struct {
+    double ms;                          /* summed over threads */
+    size_t bytes_allocated;             /* by the AST arena */
+    size_t bytes_written;
+    size_t created[NODE_TYPE_COUNT];    /* nodes created, by type */
+} PhaseStats;
+
+
+/* Counters for one file, or for a whole run once merged. */
+typedef struct {
+    size_t files;
+    size_t bytes_read;
+    size_t tokens;
+    PhaseStats phases[PHASE_COUNT];
+} FileStats;
+
+
+/* Totals of a run; workers merge their files into it as they finish. */
+typedef struct {
+    FileStats total;
+    double wall_ms;
+    pthread_mutex_t lock;    /* guards total */
+} RunStats;
+
+
+/* Where a phase started: the clock and the calling thread's AST
+   allocation counters. */
+typedef struct {
+    double ms;
+    AstAllocStats alloc;
+} PhaseMark;
+
+
+void phase_mark(PhaseMark* mark);
+
+/* Adds the time and allocations since `mark` on this thread, and
+   `bytes_written`, to `phase`. */
+void phase_add(PhaseStats* phase, const PhaseMark* mark, size_t bytes_written);
+
+void phase_stats_merge(PhaseStats* total, const PhaseStats* part);
+
+void run_stats_init(RunStats* stats);
+
+void run_stats_free(RunStats* stats);
+
+void run_stats_merge(RunStats* stats, const FileStats* file);
+
+/* Prints the totals as aligned tables, or as one JSON object. */
+void run_stats_print(const RunStats* stats, FILE* output, int json);
+
+#endif
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "symmap.h"
+
+
+static size_t symmap_index(const SymMap* map, const char* name) {
+    size_t mask = map->capacity - 1;
+    size_t i = (size_t)(((uintptr_t)name >> 3) * 0x9E3779B97F4A7C15ull) & mask;
+    while (map->slots[i].name && map->slots[i].name != name) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+
+static void symmap_grow(SymMap* map) {
+    SymSlot* old = map->slots;
+    size_t old_capacity = map->capacity;
+
+    map->capacity = old_capacity ? old_capacity * 2 : 64;
+    map->slots = (SymSlot*)calloc(map->capacity, sizeof(SymSlot));
+    if (!map->slots) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old[i].name) {
+            map->slots[symmap_index(map, old[i].name)] = old[i];
+        }
+    }
+    free(old);
+}
+
+
+SymSlot* symmap_find(const SymMap* map, const char* name) {
+    if (!map->capacity) return NULL;
+
+    SymSlot* slot = &map->slots[symmap_index(map, name)];
+    return slot->name ? slot : NULL;
+}
+
+
+SymSlot* symmap_insert(SymMap* map, const char* name, int initial) {
+    if ((map->count + 1) * 2 > map->capacity) {
+        symmap_grow(map);
+    }
+
+    SymSlot* slot = &map->slots[symmap_index(map, name)];
+    if (!slot->name) {
+        slot->name = name;
+        slot->value = initial;
+        map->count++;
+    }
+    return slot;
+}
+
+
+void symmap_clear(SymMap* map) {
+    free(map->slots);
+    map->slots = NULL;
+    map->capacity = 0;
+    map->count = 0;
+}
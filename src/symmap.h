@@ -0,0 +1,30 @@
+#ifndef SYMMAP_H
+#define SYMMAP_H
+
+#include <stddef.h>
+
+
+/* Maps an interned name to an int; names are unique pointers, so the
+   pointer itself is the key. A zeroed SymMap is empty and ready to use. */
+typedef struct {
+    const char* name;
+    int value;
+} SymSlot;
+
+
+typedef struct {
+    SymSlot* slots;
+    size_t capacity;
+    size_t count;
+} SymMap;
+
+
+/* Returns the slot for `name`, or NULL when it has never been inserted. */
+SymSlot* symmap_find(const SymMap* map, const char* name);
+
+/* Returns the slot for `name`, inserting it with `initial` if missing. */
+SymSlot* symmap_insert(SymMap* map, const char* name, int initial);
+
+void symmap_clear(SymMap* map);
+
+#endif
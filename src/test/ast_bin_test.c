@@ -0,0 +1,146 @@
+/* Checks that ast_bin_read rejects serialized trees the passes could not
+   walk safely.
+
+   Built from src/, from every source but main.c, input.c and bench.c:
+       cc -O2 -I. -o ast_bin_test test/ast_bin_test.c $(ls *.c | grep -v -e '^main.c$' -e '^input.c$' -e '^bench.c$') -lpthread
+   A small program is parsed and serialized, then one link at a time is
+   broken in a copy of the bytes. Exits with 1 if any copy is accepted. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ast_bin.h"
+#include "ast_soa.h"
+#include "parse.h"
+
+
+static const char program[] =
+    "int main() {\n"
+    "    int a = 1;\n"
+    "    if (a < 2) { print(a + 3, a--); }\n"
+    "    return a * 4;\n"
+    "}\n";
+
+
+/* The sections of a serialized tree, pointing into its bytes. */
+typedef struct {
+    size_t count;
+    uint32_t* left;
+    uint32_t* right;
+    uint32_t* next;
+    uint8_t* kind;
+} BinView;
+
+
+static BinView view(char* data) {
+    AstBinHeader header;
+    BinView v;
+
+    memcpy(&header, data, sizeof(header));
+    uint32_t* word = (uint32_t*)(data + sizeof(header));
+    v.count = header.node_count;
+    v.left = word + v.count;
+    v.right = word + 2 * v.count;
+    v.next = word + 3 * v.count;
+    v.kind = (uint8_t*)(word + 6 * v.count + header.item_count + header.symbol_count + 1);
+    return v;
+}
+
+
+static size_t find_kind(const BinView* v, NodeType type) {
+    for (size_t i = 0; i < v->count; i++) {
+        if (v->kind[i] == type) return i;
+    }
+    fprintf(stderr, "no %s node in the test program\n", get_node_type_str(type));
+    exit(1);
+}
+
+
+static int failures;
+
+
+/* `data` is a changed copy, which must not load. */
+static void expect_rejected(const char* what, const char* data, size_t size) {
+    ASTNode* root = ast_bin_read(data, size);
+    printf("%-40s %s\n", what, root ? "ACCEPTED" : "rejected");
+    if (root) failures++;
+    reset_ast();
+}
+
+
+int main(void) {
+    char source[sizeof(program) + 1];
+    Parser parser;
+    OutBuf out;
+    char* data = NULL;
+    size_t size = 0;
+
+    memcpy(source, program, sizeof(program));
+    source[sizeof(program)] = '\0';
+    parser_init(&parser);
+    ASTNode* root = parser_parse_buffer(&parser, source, sizeof(program) - 1, "test");
+    if (!root) return 1;
+
+    outbuf_init(&out, open_memstream(&data, &size));
+    if (!out.file) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return 1;
+    }
+    ast_bin_write(root, &out);
+    outbuf_close(&out);
+    fclose(out.file);
+    reset_ast();
+
+    if (!ast_bin_read(data, size)) {
+        printf("the unchanged tree was rejected\n");
+        return 1;
+    }
+    reset_ast();
+
+    char* copy = (char*)malloc(size);
+    if (!copy) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return 1;
+    }
+    memcpy(copy, data, size);
+    BinView v = view(copy);
+
+    v.left[find_kind(&v, NODE_BINOP)] = SOA_NONE;
+    expect_rejected("binary operator without left operand", copy, size);
+
+    memcpy(copy, data, size);
+    v.right[find_kind(&v, NODE_BINOP)] = SOA_NONE;
+    expect_rejected("binary operator without right operand", copy, size);
+
+    memcpy(copy, data, size);
+    v.left[find_kind(&v, NODE_UNARY)] = SOA_NONE;
+    expect_rejected("unary operator without operand", copy, size);
+
+    memcpy(copy, data, size);
+    v.left[find_kind(&v, NODE_IF)] = SOA_NONE;
+    expect_rejected("if without condition", copy, size);
+
+    /* A leaf given the next node as a child. */
+    memcpy(copy, data, size);
+    size_t leaf = find_kind(&v, NODE_INT);
+    v.left[leaf] = (uint32_t)leaf + 1;
+    expect_rejected("literal with a child", copy, size);
+
+    /* The right operand also reached from the left one, so both the
+       operator and its left operand are its parents. */
+    memcpy(copy, data, size);
+    size_t binop = find_kind(&v, NODE_BINOP);
+    v.next[v.left[binop]] = v.right[binop];
+    expect_rejected("node with two parents", copy, size);
+
+    /* The second child made the first's too, leaving one unreachable. */
+    memcpy(copy, data, size);
+    v.right[binop] = v.left[binop];
+    expect_rejected("operands that are one node", copy, size);
+
+    free(copy);
+    free(data);
+    parser_free(&parser);
+    free_ast(NULL);
+    return failures ? 1 : 0;
+}
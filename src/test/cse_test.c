@@ -0,0 +1,151 @@
+/* Checks what common-subexpression elimination does on small programs.
+
+   Built from src/, from every source but main.c, input.c and bench.c:
+       cc -O2 -I. -o cse_test test/cse_test.c $(ls *.c | grep -v -e '^main.c$' -e '^input.c$' -e '^bench.c$') -lpthread
+   Each program is optimized with and without hash-consing. The printed
+   tree must declare the expected number of temporaries, each before it
+   is read, and keep the expected number of operators. Exits with 1 on
+   any mismatch. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ast.h"
+#include "optimize.h"
+#include "parse.h"
+
+
+typedef struct {
+    const char* program;
+    int temps;               /* __cse declarations */
+    int binops;              /* operators left in the tree */
+} CseCase;
+
+
+static const CseCase cases[] = {
+    { "int main() {\n"
+      "    print(x + 1);\n"
+      "    print(x + 1);\n"
+      "    return 0;\n"
+      "}\n", 1, 1 },
+
+    /* Operands equal to 1 once hashed like the "no candidate" mark. */
+    { "int main() {\n"
+      "    print(y - 1, y * 1, 1 + y);\n"
+      "    print(y - 1, y * 1, 1 + y);\n"
+      "    return 0;\n"
+      "}\n", 3, 3 },
+
+    /* An expression reused as a whole gets one temporary, not one for
+       its parts too. */
+    { "int main() {\n"
+      "    print(a * b + 2);\n"
+      "    print(a * b + 2, c);\n"
+      "    return 0;\n"
+      "}\n", 1, 2 },
+
+    /* x changes in between, so nothing is shared. */
+    { "int main() {\n"
+      "    print(x + 1);\n"
+      "    x++;\n"
+      "    print(x + 1);\n"
+      "    return 0;\n"
+      "}\n", 0, 2 },
+
+    /* The occurrence in the if body stays, as the temporary is declared
+       after it. */
+    { "int main() {\n"
+      "    if (c) { print(a * b / a); }\n"
+      "    print(a * b / a, a * b + 1);\n"
+      "    return 0;\n"
+      "}\n", 1, 5 }
+};
+
+
+static int count(const char* text, const char* needle) {
+    int n = 0;
+    for (const char* p = strstr(text, needle); p; p = strstr(p + 1, needle)) {
+        n++;
+    }
+    return n;
+}
+
+
+/* 1 if every temporary read in `text` was declared on an earlier line. */
+static int declared_before_use(const char* text) {
+    char name[64];
+
+    for (int i = 0; ; i++) {
+        int len = snprintf(name, sizeof(name), "DECLARATION (__cse%d)", i);
+        const char* decl = strstr(text, name);
+        snprintf(name, sizeof(name), "VAR (__cse%d)", i);
+        const char* use = strstr(text, name);
+        if (!decl) return use == NULL;
+        if (use && use < decl + len) return 0;
+    }
+}
+
+
+/* Optimizes `program` and prints the tree into *text, which the caller
+   frees. */
+static void optimize(Parser* parser, const char* program, int hash_cons, char** text, size_t* size) {
+    size_t len = strlen(program);
+    char* source = (char*)calloc(len + 2, 1);
+    PassStats stats;
+    OutBuf out;
+
+    if (!source) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    memcpy(source, program, len);
+    ast_set_hash_consing(hash_cons);
+    ASTNode* root = parser_parse_buffer(parser, source, len, "test");
+    if (!root) exit(1);
+
+    fold_constants(root, &stats);
+    eliminate_dead_code(root, &stats);
+    eliminate_common_subexpressions(root, &stats);
+
+    outbuf_init(&out, open_memstream(text, size));
+    if (!out.file) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    write_ast(root, &out, 0);
+    outbuf_close(&out);
+    fclose(out.file);
+
+    reset_ast();
+    free(source);
+}
+
+
+int main(void) {
+    Parser parser;
+    int failures = 0;
+
+    parser_init(&parser);
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        for (int hash_cons = 0; hash_cons <= 1; hash_cons++) {
+            char* text = NULL;
+            size_t size = 0;
+            optimize(&parser, cases[i].program, hash_cons, &text, &size);
+            int temps = count(text, "DECLARATION (__cse");
+            int binops = count(text, "BINARY_EXPR");
+            int ok = temps == cases[i].temps && binops == cases[i].binops && declared_before_use(text);
+
+            printf("program %zu%s: %d temporaries, %d operators: %s\n", i + 1,
+                   hash_cons ? " (hash-consed)" : "", temps, binops, ok ? "ok" : "WRONG");
+            if (!ok) {
+                printf("expected %d temporaries and %d operators:\n%s\n",
+                       cases[i].temps, cases[i].binops, text);
+                failures++;
+            }
+            free(text);
+        }
+    }
+    parser_free(&parser);
+    free_ast(NULL);
+    return failures ? 1 : 0;
+}
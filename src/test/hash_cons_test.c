@@ -0,0 +1,101 @@
+/* Checks that hash-consing does not change what the passes produce.
+
+   Built from src/, from every source but main.c, input.c and bench.c:
+       cc -O2 -I. -o hash_cons_test test/hash_cons_test.c $(ls *.c | grep -v -e '^main.c$' -e '^input.c$' -e '^bench.c$') -lpthread
+   Each program is parsed, optimized and printed once with hash-consing
+   and once without, and the printed trees must be the same. The programs
+   share expressions between call arguments and other statements, which
+   common-subexpression elimination has to rewrite in one place only.
+   Exits with 1 on any difference. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ast.h"
+#include "optimize.h"
+#include "parse.h"
+
+
+static const char* const programs[] = {
+    "int main() {\n"
+    "    if (c) { print(a * b / a); }\n"
+    "    print(a * b / a, a * b + 1);\n"
+    "    return 0;\n"
+    "}\n",
+
+    "int main() {\n"
+    "    print(f(a * b - c), a * b - c);\n"
+    "    print(a * b - c, g(a * b));\n"
+    "    return a * b;\n"
+    "}\n",
+
+    /* The ++ in the if body must not hide the later use of v * v. */
+    "int main() {\n"
+    "    int w = v * v - v - 70;\n"
+    "    w++;\n"
+    "    if (f(v, w + v * v < 209) / w) { v++; }\n"
+    "    return 0;\n"
+    "}\n"
+};
+
+
+/* The optimized tree of `program` as write_ast prints it; the caller
+   frees it. */
+static char* optimize(Parser* parser, const char* program, int hash_cons) {
+    size_t len = strlen(program);
+    char* source = (char*)calloc(len + 2, 1);
+    char* text = NULL;
+    size_t size = 0;
+    PassStats stats;
+    OutBuf out;
+
+    if (!source) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    memcpy(source, program, len);
+    ast_set_hash_consing(hash_cons);
+    ASTNode* root = parser_parse_buffer(parser, source, len, "test");
+    if (!root) exit(1);
+
+    fold_constants(root, &stats);
+    eliminate_dead_code(root, &stats);
+    eliminate_common_subexpressions(root, &stats);
+
+    outbuf_init(&out, open_memstream(&text, &size));
+    if (!out.file) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    write_ast(root, &out, 0);
+    outbuf_close(&out);
+    fclose(out.file);
+
+    reset_ast();
+    free(source);
+    return text;
+}
+
+
+int main(void) {
+    Parser parser;
+    int failures = 0;
+
+    parser_init(&parser);
+    for (size_t i = 0; i < sizeof(programs) / sizeof(programs[0]); i++) {
+        char* plain = optimize(&parser, programs[i], 0);
+        char* consed = optimize(&parser, programs[i], 1);
+        int same = strcmp(plain, consed) == 0;
+
+        printf("program %zu: %s\n", i + 1, same ? "same" : "DIFFERENT");
+        if (!same) {
+            printf("without hash-consing:\n%s\nwith hash-consing:\n%s\n", plain, consed);
+            failures++;
+        }
+        free(plain);
+        free(consed);
+    }
+    parser_free(&parser);
+    free_ast(NULL);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,65 @@
+/* Checks that the walker goes past list slots a pass has emptied.
+
+   Built from src/, from every source but main.c, input.c and bench.c:
+       cc -O2 -I. -o walk_test test/walk_test.c $(ls *.c | grep -v -e '^main.c$' -e '^input.c$' -e '^bench.c$') -lpthread
+   A block of four statements has one slot cleared at a time, the first
+   and last included, and every other statement must still be visited,
+   in order. Exits with 1 otherwise. */
+
+#include <stdio.h>
+#include <string.h>
+#include "ast.h"
+#include "walk.h"
+
+
+#define STATEMENTS 4
+
+
+typedef struct {
+    const char* seen[STATEMENTS + 1];
+    size_t count;
+} Visits;
+
+
+static WalkAction record(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    Visits* visits = (Visits*)ctx;
+    (void)walker;
+
+    if (frame->node->type == NODE_VAR && visits->count < STATEMENTS + 1) {
+        visits->seen[visits->count++] = frame->node->value.sym;
+    }
+    return WALK_CONTINUE;
+}
+
+
+int main(void) {
+    static const char* const names[STATEMENTS] = { "a", "b", "c", "d" };
+    AstWalker walker;
+    int failures = 0;
+
+    walker_init(&walker);
+    for (size_t cleared = 0; cleared < STATEMENTS; cleared++) {
+        ASTNode* block = make_block_node(make_var_node(names[0]));
+        for (size_t i = 1; i < STATEMENTS; i++) {
+            list_append(block, make_var_node(names[i]));
+        }
+        block->value.items[cleared] = NULL;
+
+        Visits visits;
+        visits.count = 0;
+        ast_walk(&walker, &block, record, NULL, &visits);
+
+        size_t expected = 0;
+        int ok = visits.count == STATEMENTS - 1;
+        for (size_t i = 0; i < STATEMENTS && ok; i++) {
+            if (i == cleared) continue;
+            ok = strcmp(visits.seen[expected++], names[i]) == 0;
+        }
+        printf("slot %zu cleared: %zu statements visited: %s\n", cleared, visits.count, ok ? "ok" : "WRONG");
+        if (!ok) failures++;
+        reset_ast();
+    }
+    walker_free(&walker);
+    free_ast(NULL);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,33 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "tokens.h"
+
+
+void token_buffer_init(TokenBuffer* tokens) {
+    tokens->items = NULL;
+    tokens->count = 0;
+    tokens->capacity = 0;
+}
+
+
+void token_buffer_free(TokenBuffer* tokens) {
+    free(tokens->items);
+    token_buffer_init(tokens);
+}
+
+
+void token_buffer_reset(TokenBuffer* tokens) {
+    tokens->count = 0;
+}
+
+
+void token_buffer_grow(TokenBuffer* tokens) {
+    size_t capacity = tokens->capacity ? tokens->capacity * 2 : 4096;
+    Token* items = (Token*)realloc(tokens->items, capacity * sizeof(Token));
+    if (!items) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    tokens->items = items;
+    tokens->capacity = capacity;
+}
@@ -0,0 +1,41 @@
+#ifndef TOKENS_H
+#define TOKENS_H
+
+#include <stddef.h>
+#include "ast.h"
+
+
+/* A token's payload; the same members as the grammar's %union. */
+typedef union {
+    int ival;             /* NUMBER */
+    const char* str;      /* IDENTIFIER and STRING, interned */
+} TokenValue;
+
+
+typedef struct {
+    int kind;             /* grammar token kind or a character; 0 ends the input */
+    SrcSpan loc;
+    TokenValue value;
+} Token;
+
+
+/* A whole input scanned ahead of the parser, so that scanning can be
+   run and timed as a stage of its own. The last token has kind 0. */
+typedef struct {
+    Token* items;
+    size_t count;
+    size_t capacity;
+} TokenBuffer;
+
+
+void token_buffer_init(TokenBuffer* tokens);
+
+void token_buffer_free(TokenBuffer* tokens);
+
+/* Empties the buffer for a new input, keeping its storage. */
+void token_buffer_reset(TokenBuffer* tokens);
+
+/* Doubles the capacity. */
+void token_buffer_grow(TokenBuffer* tokens);
+
+#endif
@@ -1,93 +1,261 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "visual.h"
+#include "walk.h"
 
-int main() {
-    FILE *f = fopen("ast.dot", "w");
-    if (!f) {
-        perror("Failed to open file");
-        return 1;
+
+static void write_dot_id(OutBuf* out, size_t id) {
+    outbuf_write(out, "node", 4);
+    outbuf_int(out, (long)id);
+}
+
+
+static void write_dot_edge(OutBuf* out, size_t from, size_t to) {
+    outbuf_write(out, "  ", 2);
+    write_dot_id(out, from);
+    outbuf_write(out, " -> ", 4);
+    write_dot_id(out, to);
+    outbuf_write(out, ";\n", 2);
+}
+
+
+static void write_dot_label(OutBuf* out, size_t id, ASTNode* node) {
+    int number = node->type == NODE_INT ? node->value.ival : (int)node->value.op;
+
+    outbuf_write(out, "  ", 2);
+    write_dot_id(out, id);
+    outbuf_write(out, " [label=\"", 9);
+    write_node_label(out, node->type, number, AST_HAS_ITEMS(node) ? NULL : node->value.sym, 1);
+}
+
+
+/* Ends the open label and starts a tooltip with the node's source
+   position, leaving the tooltip's quote for the caller to close. */
+static void write_dot_tooltip(OutBuf* out, const LineIndex* lines, ASTNode* node) {
+    unsigned line, column;
+
+    if (!lines || !node->loc.length) return;
+    line_index_lookup(lines, node->loc.offset, &line, &column);
+    outbuf_puts(out, "\", tooltip=\"line ");
+    outbuf_int(out, (long)line);
+    outbuf_puts(out, ", col ");
+    outbuf_int(out, (long)column);
+}
+
+
+typedef struct {
+    OutBuf* out;
+    const LineIndex* lines;
+} DotWriter;
+
+
+static WalkAction dot_node(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    DotWriter* dw = (DotWriter*)ctx;
+    OutBuf* out = dw->out;
+
+    write_dot_label(out, frame->order, frame->node);
+    write_dot_tooltip(out, dw->lines, frame->node);
+    outbuf_write(out, "\"];\n", 4);
+
+    WalkFrame* parent = walk_parent(walker, frame);
+    if (parent) {
+        write_dot_edge(out, parent->order, frame->order);
+    }
+    return WALK_CONTINUE;
+}
+
+
+size_t write_dot(ASTNode* root, OutBuf* out, const LineIndex* lines) {
+    DotWriter dw = { out, lines };
+    AstWalker walker;
+    size_t count;
+
+    outbuf_puts(out, "digraph AST {\n");
+    walker_init(&walker);
+    if (root) {
+        ast_walk(&walker, &root, dot_node, NULL, &dw);
+    }
+    count = walker.visited;
+    walker_free(&walker);
+    outbuf_puts(out, "}\n");
+
+    return count;
+}
+
+
+/* Focus flags gathered by the first walk. */
+#define DOT_INSIDE 1      /* the focus function or one of its descendants */
+#define DOT_CONTAINS 2    /* an ancestor of the focus function */
+
+#define DOT_TRUNCATED ((size_t)1 << (sizeof(size_t) * 8 - 1))
+
+
+/* Subtree sizes and focus flags, indexed by pre-order index. */
+typedef struct {
+    size_t* sizes;
+    unsigned char* flags;
+    size_t capacity;
+    size_t count;
+    const char* focus;
+} DotScan;
+
+
+typedef struct {
+    OutBuf* out;
+    const LineIndex* lines;
+    const DotOptions* opts;
+    const DotScan* scan;
+    size_t emitted;
+    size_t skipped;      /* nodes of the first walk not seen by this one */
+    size_t* reserved;    /* by ID, with --dot-budget: slots kept for the levels above its children */
+    int root_truncated;
+} DotCollapse;
+
+
+static WalkAction dot_scan_pre(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    DotScan* scan = (DotScan*)ctx;
+    ASTNode* node = frame->node;
+    size_t id = frame->order;
+
+    if (id == scan->capacity) {
+        scan->capacity = scan->capacity ? scan->capacity * 2 : 1024;
+        scan->sizes = (size_t*)realloc(scan->sizes, scan->capacity * sizeof(size_t));
+        scan->flags = (unsigned char*)realloc(scan->flags, scan->capacity);
+        if (!scan->sizes || !scan->flags) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+    }
+
+    WalkFrame* parent = walk_parent(walker, frame);
+    scan->sizes[id] = 1;
+    scan->flags[id] = parent ? scan->flags[parent->order] & DOT_INSIDE : 0;
+    if (scan->focus && node->type == NODE_FUNC_DEF && node->value.sym &&
+        strcmp(node->value.sym, scan->focus) == 0) {
+        scan->flags[id] = DOT_INSIDE;
+    }
+    return WALK_CONTINUE;
+}
+
+
+static WalkAction dot_scan_post(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    DotScan* scan = (DotScan*)ctx;
+    WalkFrame* parent = walk_parent(walker, frame);
+
+    if (parent) {
+        scan->sizes[parent->order] += scan->sizes[frame->order];
+        if (scan->flags[frame->order]) {
+            scan->flags[parent->order] |= DOT_CONTAINS;
+        }
+    }
+    return WALK_CONTINUE;
+}
+
+
+static WalkAction dot_collapse_pre(AstWalker* walker, WalkFrame* frame, void* ctx) {
+    DotCollapse* dc = (DotCollapse*)ctx;
+    const DotOptions* opts = dc->opts;
+    const DotScan* scan = dc->scan;
+    ASTNode* node = frame->node;
+    WalkFrame* parent = walk_parent(walker, frame);
+
+    /* IDs are pre-order indices in the full tree, as in write_dot, so
+       they stay stable whatever gets collapsed. */
+    size_t id = frame->order + dc->skipped;
+    size_t size = scan->sizes[id];
+    size_t depth = (size_t)frame->depth;
+
+    if (parent ? (parent->data & DOT_TRUNCATED) != 0 : dc->root_truncated) {
+        dc->skipped += size - 1;
+        return WALK_SKIP;
+    }
+
+    int collapse = size > 1 &&
+                   ((opts->focus && !scan->flags[id]) ||
+                    (depth > 0 && opts->max_depth > 0 && depth >= (size_t)opts->max_depth) ||
+                    (depth > 0 && opts->max_size && size > opts->max_size && !AST_HAS_ITEMS(node)));
+
+    /* A level with nodes still to come after this one, the root's
+       included, keeps a slot for the first of them or their summary, and
+       so do this node's children if it shows them. Without room for its
+       children the node is shown collapsed, and without room for itself
+       it summarizes the rest of its level, which always fits. Every slot
+       kept is used later, so the budget is filled exactly. */
+    size_t end = parent ? (parent->data + scan->sizes[parent->data]) : scan->count;
+    size_t above = parent && opts->budget ? dc->reserved[parent->data] : 0;
+    size_t later = end > id + size;
+    if (opts->budget && !collapse && size > 1 && dc->emitted + 2 + above + later > opts->budget) {
+        collapse = 1;
+    }
+    if (opts->budget && dc->emitted + 1 + above + later > opts->budget) {
+        outbuf_write(dc->out, "  ", 2);
+        write_dot_id(dc->out, id);
+        outbuf_write(dc->out, " [label=\"", 9);
+        outbuf_int(dc->out, (long)(end - id));
+        outbuf_puts(dc->out, " more nodes\", style=dashed];\n");
+        if (parent) {
+            write_dot_edge(dc->out, parent->data, id);
+            parent->data |= DOT_TRUNCATED;
+        } else {
+            dc->root_truncated = 1;
+        }
+        dc->emitted++;
+        dc->skipped += size - 1;
+        return WALK_SKIP;
+    }
+
+    write_dot_label(dc->out, id, node);
+    if (collapse) {
+        outbuf_write(dc->out, "\\n", 2);
+        outbuf_int(dc->out, (long)size);
+        outbuf_puts(dc->out, " nodes");
+        write_dot_tooltip(dc->out, dc->lines, node);
+        outbuf_puts(dc->out, "\", style=dashed];\n");
+    } else {
+        write_dot_tooltip(dc->out, dc->lines, node);
+        outbuf_write(dc->out, "\"];\n", 4);
+    }
+    if (parent) {
+        write_dot_edge(dc->out, parent->data, id);
+    }
+    frame->data = id;
+    dc->emitted++;
+    if (opts->budget) dc->reserved[id] = above + later;
+
+    if (collapse) {
+        dc->skipped += size - 1;
+        return WALK_SKIP;
+    }
+    return WALK_CONTINUE;
+}
+
+
+size_t write_dot_collapsed(ASTNode* root, OutBuf* out, const DotOptions* opts,
+                           const LineIndex* lines) {
+    DotScan scan = { NULL, NULL, 0, 0, opts->focus };
+    DotCollapse dc = { out, lines, opts, &scan, 0, 0, NULL, 0 };
+    AstWalker walker;
+
+    outbuf_puts(out, "digraph AST {\n");
+    walker_init(&walker);
+    if (root) {
+        ast_walk(&walker, &root, dot_scan_pre, dot_scan_post, &scan);
+        scan.count = walker.visited;
+        if (opts->budget) {
+            dc.reserved = (size_t*)malloc(scan.count * sizeof(size_t));
+            if (!dc.reserved) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(1);
+            }
+        }
+        ast_walk(&walker, &root, dot_collapse_pre, NULL, &dc);
     }
+    walker_free(&walker);
+    outbuf_puts(out, "}\n");
 
-    fprintf(f, "digraph AST {\n");
-    fprintf(f, "  node0 [label=\"FUNCTION_DEF (main)\"];\n");
-
-    fprintf(f, "  node1 [label=\"DECLARATION (a)\"];\n");
-    fprintf(f, "  node2 [label=\"BINARY_EXPR (*)\"];\n");
-    fprintf(f, "  node3 [label=\"INT (5)\"];\n");
-    fprintf(f, "  node4 [label=\"INT (3)\"];\n");
-    fprintf(f, "  node0 -> node1;\n");
-    fprintf(f, "  node1 -> node2;\n");
-    fprintf(f, "  node2 -> node3;\n");
-    fprintf(f, "  node2 -> node4;\n");
-
-    fprintf(f, "  node5 [label=\"DECLARATION (b)\"];\n");
-    fprintf(f, "  node6 [label=\"INT (10)\"];\n");
-    fprintf(f, "  node0 -> node5;\n");
-    fprintf(f, "  node5 -> node6;\n");
-
-    fprintf(f, "  node7 [label=\"DECLARATION (c)\"];\n");
-    fprintf(f, "  node8 [label=\"INT (0)\"];\n");
-    fprintf(f, "  node0 -> node7;\n");
-    fprintf(f, "  node7 -> node8;\n");
-
-    fprintf(f, "  node9 [label=\"IF_STMT (0)\"];\n");
-    fprintf(f, "  node10 [label=\"FUNCTION_CALL (printf)\"];\n");
-    fprintf(f, "  node11 [label=\"STRING (This will never be printed.)\"];\n");
-    fprintf(f, "  node0 -> node9;\n");
-    fprintf(f, "  node9 -> node10;\n");
-    fprintf(f, "  node10 -> node11;\n");
-
-    fprintf(f, "  node12 [label=\"IF_STMT (1)\"];\n");
-    fprintf(f, "  node13 [label=\"FUNCTION_CALL (printf)\"];\n");
-    fprintf(f, "  node14 [label=\"STRING (This will always be printed.)\"];\n");
-    fprintf(f, "  node0 -> node12;\n");
-    fprintf(f, "  node12 -> node13;\n");
-    fprintf(f, "  node13 -> node14;\n");
-
-    fprintf(f, "  node15 [label=\"DECLARATION (d)\"];\n");
-    fprintf(f, "  node16 [label=\"BINARY_EXPR (+)\"];\n");
-    fprintf(f, "  node17 [label=\"VAR (a)\"];\n");
-    fprintf(f, "  node18 [label=\"BINARY_EXPR (*)\"];\n");
-    fprintf(f, "  node19 [label=\"INT (2)\"];\n");
-    fprintf(f, "  node20 [label=\"INT (4)\"];\n");
-    fprintf(f, "  node0 -> node15;\n");
-    fprintf(f, "  node15 -> node16;\n");
-    fprintf(f, "  node16 -> node17;\n");
-    fprintf(f, "  node16 -> node18;\n");
-    fprintf(f, "  node18 -> node19;\n");
-    fprintf(f, "  node18 -> node20;\n");
-
-    fprintf(f, "  node21 [label=\"FOR_STMT\"];\n");
-    fprintf(f, "  node22 [label=\"DECLARATION (i)\"];\n");
-    fprintf(f, "  node23 [label=\"INT (0)\"];\n");
-    fprintf(f, "  node24 [label=\"BINARY_EXPR (<)\"];\n");
-    fprintf(f, "  node25 [label=\"VAR (i)\"];\n");
-    fprintf(f, "  node26 [label=\"INT (3)\"];\n");
-    fprintf(f, "  node27 [label=\"UNARY_EXPR (++)\"];\n");
-    fprintf(f, "  node28 [label=\"VAR (i)\"];\n");
-    fprintf(f, "  node29 [label=\"FUNCTION_CALL (printf)\"];\n");
-    fprintf(f, "  node30 [label=\"STRING (Hello Kunal)\"];\n");
-
-    fprintf(f, "  node0 -> node21;\n");
-    fprintf(f, "  node21 -> node22;\n");
-    fprintf(f, "  node22 -> node23;\n");
-    fprintf(f, "  node21 -> node24;\n");
-    fprintf(f, "  node24 -> node25;\n");
-    fprintf(f, "  node24 -> node26;\n");
-    fprintf(f, "  node21 -> node27;\n");
-    fprintf(f, "  node27 -> node28;\n");
-    fprintf(f, "  node21 -> node29;\n");
-    fprintf(f, "  node29 -> node30;\n");
-
-    fprintf(f, "  node31 [label=\"RETURN_STMT\"];\n");
-    fprintf(f, "  node32 [label=\"INT (0)\"];\n");
-    fprintf(f, "  node0 -> node31;\n");
-    fprintf(f, "  node31 -> node32;\n");
-
-    fprintf(f, "}\n");
-
-    fclose(f);
-
-    printf("DOT file 'ast.dot' generated.\n");
-    printf("Run: dot -Tpng ast.dot -o ast.png\n");
-    return 0;
+    free(scan.sizes);
+    free(scan.flags);
+    free(dc.reserved);
+    return dc.emitted;
 }
@@ -0,0 +1,35 @@
+#ifndef VISUAL_H
+#define VISUAL_H
+
+#include "ast.h"
+#include "outbuf.h"
+#include "source.h"
+
+
+/* Writes the tree as a Graphviz digraph. Nodes are numbered in print_ast
+   order during the same walk that emits them, and every node gets an edge
+   from its parent, so the graph is produced in one streaming pass.
+   With `lines` (the index of the parsed text), each parsed node gets a
+   tooltip with its line and column. Returns the number of nodes written. */
+size_t write_dot(ASTNode* root, OutBuf* out, const LineIndex* lines);
+
+
+/* Limits for write_dot_collapsed; zero (or NULL) disables a limit. */
+typedef struct {
+    int max_depth;        /* nodes at this depth stand in for their subtree */
+    size_t max_size;      /* statements and expressions larger than this are collapsed */
+    const char* focus;    /* only expand the path to this FUNCTION_DEF */
+    size_t budget;        /* hard cap on emitted nodes, summaries included */
+} DotOptions;
+
+
+/* Like write_dot, but subtrees cut by the options are drawn as one dashed
+   summary node labelled with the number of nodes it hides. Once the
+   budget runs out, the rest of each open list or chain becomes a single
+   summary node. Block and argument lists are never collapsed by size;
+   their items are judged one by one. Returns the number of nodes
+   written. */
+size_t write_dot_collapsed(ASTNode* root, OutBuf* out, const DotOptions* opts,
+                           const LineIndex* lines);
+
+#endif
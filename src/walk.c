@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "walk.h"
+
+
+#define WALK_INITIAL_CAPACITY 64
+
+
+void walker_init(AstWalker* walker) {
+    walker->stack = NULL;
+    walker->top = 0;
+    walker->capacity = 0;
+    walker->visited = 0;
+}
+
+
+void walker_free(AstWalker* walker) {
+    free(walker->stack);
+    walker_init(walker);
+}
+
+
+static void push_frame(AstWalker* walker, ASTNode** link, size_t parent, int depth, int chain) {
+    if (walker->top == walker->capacity) {
+        size_t capacity = walker->capacity ? walker->capacity * 2 : WALK_INITIAL_CAPACITY;
+        WalkFrame* stack = (WalkFrame*)realloc(walker->stack, capacity * sizeof(WalkFrame));
+        if (!stack) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        walker->stack = stack;
+        walker->capacity = capacity;
+    }
+
+    WalkFrame* frame = &walker->stack[walker->top++];
+    frame->link = link;
+    frame->node = NULL;
+    frame->parent = parent;
+    frame->order = 0;
+    frame->depth = depth;
+    frame->stage = 0;
+    frame->chain = chain;
+    frame->item = 0;
+    frame->data = 0;
+}
+
+
+/* Pops the top frame and pushes what comes after it: the next item of
+   the parent's list, then the node's next sibling. List items are pushed
+   one at a time so a wide block does not need a frame per statement. */
+static void pop_frame(AstWalker* walker) {
+    WalkFrame* frame = &walker->stack[walker->top - 1];
+    ASTNode* node = *frame->link;
+    size_t parent = frame->parent;
+    int depth = frame->depth;
+    int follow = frame->chain && node && node->next;
+    unsigned item = frame->item;
+
+    walker->top--;
+    if (item && item < walker->stack[parent].node->count) {
+        push_frame(walker, &walker->stack[parent].node->value.items[item], parent, depth, 1);
+        walker->stack[walker->top - 1].item = item + 1;
+    }
+    if (follow) push_frame(walker, &node->next, parent, depth, 1);
+}
+
+
+static void walk(AstWalker* walker, ASTNode** root, int chain, WalkFn pre, WalkFn post, void* ctx) {
+    walker->top = 0;
+    walker->visited = 0;
+    push_frame(walker, root, WALK_NO_PARENT, 0, chain);
+
+    while (walker->top) {
+        size_t index = walker->top - 1;
+        WalkFrame* frame = &walker->stack[index];
+
+        if (frame->stage == 0) {
+            ASTNode* node = *frame->link;
+            if (!node) {
+                /* An emptied list slot: go on with the next item. */
+                pop_frame(walker);
+                continue;
+            }
+
+            frame->node = node;
+            frame->order = walker->visited++;
+            frame->stage = 1;
+
+            WalkAction action = pre ? pre(walker, frame, ctx) : WALK_CONTINUE;
+            if (action == WALK_SKIP) continue;
+
+            /* Pushed in reverse so the left chain is visited first and
+               list items come last, in order. */
+            int depth = frame->depth + 1;
+            if (AST_HAS_ITEMS(node) && node->count) {
+                push_frame(walker, &node->value.items[0], index, depth, 1);
+                walker->stack[walker->top - 1].item = 1;
+            }
+            if (node->right) push_frame(walker, &node->right, index, depth, 1);
+            if (node->left) push_frame(walker, &node->left, index, depth, 1);
+            continue;
+        }
+
+        if (post) post(walker, frame, ctx);
+        pop_frame(walker);
+    }
+}
+
+
+void ast_walk(AstWalker* walker, ASTNode** root, WalkFn pre, WalkFn post, void* ctx) {
+    walk(walker, root, 1, pre, post, ctx);
+}
+
+
+void ast_walk_node(AstWalker* walker, ASTNode** root, WalkFn pre, WalkFn post, void* ctx) {
+    walk(walker, root, 0, pre, post, ctx);
+}
+
+
+WalkFrame* walk_parent(AstWalker* walker, const WalkFrame* frame) {
+    return frame->parent == WALK_NO_PARENT ? NULL : &walker->stack[frame->parent];
+}
@@ -0,0 +1,62 @@
+#ifndef WALK_H
+#define WALK_H
+
+#include <stddef.h>
+#include "ast.h"
+
+
+typedef enum {
+    WALK_CONTINUE,
+    WALK_SKIP          /* from a pre callback: do not visit the children */
+} WalkAction;
+
+
+typedef struct {
+    ASTNode** link;    /* the pointer that refers to the node */
+    ASTNode* node;
+    size_t parent;     /* stack index of the parent frame, or WALK_NO_PARENT */
+    size_t order;      /* pre-order index within the current walk */
+    int depth;
+    int stage;
+    int chain;         /* continue along node->next after this node */
+    unsigned item;     /* 1 + index in the parent's items, or 0 */
+    size_t data;       /* free for the callbacks */
+} WalkFrame;
+
+#define WALK_NO_PARENT ((size_t)-1)
+
+
+typedef struct AstWalker AstWalker;
+
+typedef WalkAction (*WalkFn)(AstWalker* walker, WalkFrame* frame, void* ctx);
+
+
+/* Explicit-stack traversal: left, right and next are followed without
+   recursion, so the C stack does not grow with the tree. The stack buffer
+   is kept between walks; a walker must not be reused from inside its own
+   callbacks. */
+struct AstWalker {
+    WalkFrame* stack;
+    size_t top;
+    size_t capacity;
+    size_t visited;
+};
+
+
+void walker_init(AstWalker* walker);
+
+void walker_free(AstWalker* walker);
+
+/* Visits *root and every node reachable from it, including root->next.
+   For each node, pre runs first, then the left and right children (each
+   with its sibling chain) and any list items one level deeper, then
+   post. post may replace the node by storing to frame->link; the walk
+   then carries on along the next chain of whatever the link holds. Either callback may be NULL. */
+void ast_walk(AstWalker* walker, ASTNode** root, WalkFn pre, WalkFn post, void* ctx);
+
+/* Like ast_walk, but does not follow root->next. */
+void ast_walk_node(AstWalker* walker, ASTNode** root, WalkFn pre, WalkFn post, void* ctx);
+
+WalkFrame* walk_parent(AstWalker* walker, const WalkFrame* frame);
+
+#endif